@@ -51,11 +51,17 @@ macro( test_setup )
     # TODO: codify version if possible
     set( VERILATOR_SIM ${PROJECT_BINARY_DIR}/test/build/${CMAKE_PROJECT_NAME}_0.1/sim-verilator/V${CMAKE_PROJECT_NAME} )
     set( REMOTE_SIM ${PROJECT_BINARY_DIR}/test/build/cm3_min_soc_0.1/sim-verilator/Vcm3_min_soc )
+    set( FT245_SIM ${PROJECT_BINARY_DIR}/test/build/${CMAKE_PROJECT_NAME}_0.1/sim_ft245-verilator/V${CMAKE_PROJECT_NAME} )
     add_custom_command(
       OUTPUT ${VERILATOR_SIM}
       COMMENT "Generating verilated sim for ${CMAKE_PROJECT_NAME}"
       COMMAND ${FUSESOC_EXECUTABLE} --config ${PROJECT_BINARY_DIR}/fusesoc.conf run --target=sim ${CMAKE_PROJECT_NAME}
       )
+    add_custom_command(
+      OUTPUT ${FT245_SIM}
+      COMMENT "Generating verilated FT245 sim for ${CMAKE_PROJECT_NAME}"
+      COMMAND ${FUSESOC_EXECUTABLE} --config ${PROJECT_BINARY_DIR}/fusesoc.conf run --target=sim_ft245 ${CMAKE_PROJECT_NAME}
+      )
     add_custom_command(
       OUTPUT ${REMOTE_SIM}
       COMMENT "Generating verilated sim for remote target"
@@ -72,7 +78,7 @@ macro( test_finalize )
       COMMAND ${CMAKE_CTEST_COMMAND} )
   else ()
     add_custom_target( check
-      DEPENDS ${VERILATOR_SIM} ${REMOTE_SIM}
+      DEPENDS ${VERILATOR_SIM} ${REMOTE_SIM} ${FT245_SIM}
       COMMAND ${CMAKE_CTEST_COMMAND} )
   endif ()
 endmacro( test_finalize )
@@ -86,6 +92,31 @@ function( fusesoc_api_test NAME SOURCES)
     COMMAND ${PROJECT_SOURCE_DIR}/test/scripts/api_test.sh ${VERILATOR_SIM} ${REMOTE_SIM} $<TARGET_FILE:${NAME}> ${FLEXSOC_HW} false ) # Set to true to trace   
 endfunction( fusesoc_api_test )
 
+# Create test against FT245 sync FIFO transport model
+function( fusesoc_ft245_test NAME SOURCES)
+  # Only applies to simulation
+  if( DEFINED ENV{FLEXSOC_HW} )
+    return ()
+  endif ()
+  add_executable( ${NAME} ${SOURCES} ${ARGN} )
+  target_link_libraries( ${NAME} flexsoc target )
+  add_test(
+    NAME ${NAME}
+    COMMAND ${CMAKE_COMMAND} -E env SIM_PORT_OPT=-f
+    ${PROJECT_SOURCE_DIR}/test/scripts/api_test.sh ${FT245_SIM} ${REMOTE_SIM} $<TARGET_FILE:${NAME}> ${FLEXSOC_HW} false ) # Set to true to trace
+endfunction( fusesoc_ft245_test )
+
+# Gateware bench run by fusesoc - exits non-zero on failure
+function( fusesoc_bench_test NAME TARGET )
+  # Only applies to simulation
+  if( DEFINED ENV{FLEXSOC_HW} )
+    return ()
+  endif ()
+  add_test(
+    NAME ${NAME}
+    COMMAND ${FUSESOC_EXECUTABLE} --config ${PROJECT_BINARY_DIR}/fusesoc.conf run --target=${TARGET} ${CMAKE_PROJECT_NAME} )
+endfunction( fusesoc_bench_test )
+
 function( fusesoc_irq_test NAME ARM_EXE SOURCES)
   add_executable( ${NAME} ${SOURCES} ${ARGN} )
   target_link_libraries( ${NAME} flexsoc target irq )
@@ -0,0 +1,141 @@
+/**
+ *  Cycle model of the FT2232H synchronous FIFO (245) interface
+ *
+ *  All rights reserved.
+ *  Tiny Labs Inc
+ *  2022
+ */
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+#include "ft245_model.h"
+
+// Cycles of idle before sending partial buffer (latency timer)
+#define LATENCY_CYCLES  64
+
+// Cycles between socket polls
+#define POLL_CYCLES     16
+
+FT245Model::FT245Model (uint16_t port)
+{
+	struct sockaddr_in addr;
+	int opt = 1;
+
+	fd = -1;
+	rxhead = rxcnt = txcnt = idle = cycle = 0;
+	do_rd = do_wr = false;
+	rxf_n = txe_n = true;
+
+	// Create listening socket
+	srvfd = socket (AF_INET, SOCK_STREAM, 0);
+	setsockopt (srvfd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof (opt));
+	memset (&addr, 0, sizeof (addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = INADDR_ANY;
+	addr.sin_port = htons (port);
+	if (bind (srvfd, (struct sockaddr *)&addr, sizeof (addr)) ||
+	    listen (srvfd, 1)) {
+		printf ("FT245: failed to listen on :%d\n", port);
+		return;
+	}
+	fcntl (srvfd, F_SETFL, fcntl (srvfd, F_GETFL, 0) | O_NONBLOCK);
+	printf ("FT245: listening on :%d\n", port);
+}
+
+FT245Model::~FT245Model ()
+{
+	if (fd >= 0)
+		close (fd);
+	close (srvfd);
+}
+
+void FT245Model::Accept (void)
+{
+	int opt = 1;
+
+	fd = accept (srvfd, NULL, NULL);
+	if (fd < 0)
+		return;
+	fcntl (fd, F_SETFL, fcntl (fd, F_GETFL, 0) | O_NONBLOCK);
+	setsockopt (fd, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof (opt));
+	printf ("FT245: host connected\n");
+}
+
+void FT245Model::Service (bool flush)
+{
+	int rv, widx, sz;
+
+	if (fd < 0) {
+		Accept ();
+		return;
+	}
+
+	// Fill RX buffer from host
+	if (rxcnt < FT245_BUF_SZ) {
+		widx = (rxhead + rxcnt) % FT245_BUF_SZ;
+		sz = (widx >= rxhead) ? FT245_BUF_SZ - widx : rxhead - widx;
+		rv = read (fd, &rxbuf[widx], sz);
+		if (rv > 0)
+			rxcnt += rv;
+		else if (rv == 0) {
+			printf ("FT245: host disconnected\n");
+			close (fd);
+			fd = -1;
+			rxhead = rxcnt = txcnt = 0;
+			return;
+		}
+	}
+
+	// Send TX buffer on send immediate, full buffer or latency timeout
+	if (txcnt && (flush || (txcnt == FT245_BUF_SZ) || (idle >= LATENCY_CYCLES))) {
+		rv = write (fd, txbuf, txcnt);
+		if (rv > 0) {
+			memmove (txbuf, &txbuf[rv], txcnt - rv);
+			txcnt -= rv;
+		}
+		idle = 0;
+	}
+}
+
+void FT245Model::Sample (uint8_t rdn, uint8_t wrn, uint8_t oen, uint8_t siwun, uint8_t data)
+{
+	// RXF#/TXE# are what we drove after the last edge
+	do_rd = !rdn && !oen && !rxf_n;
+	do_wr = !wrn && !txe_n;
+	wrdata = data;
+
+	// Send immediate flushes to host right away
+	if (!siwun)
+		Service (true);
+}
+
+void FT245Model::Drive (uint8_t *rxfn, uint8_t *txen, uint8_t *data)
+{
+	// Complete transfers latched on this edge
+	if (do_rd) {
+		rxhead = (rxhead + 1) % FT245_BUF_SZ;
+		rxcnt--;
+	}
+	if (do_wr) {
+		txbuf[txcnt++] = wrdata;
+		idle = 0;
+	}
+	else
+		idle++;
+
+	// Talk to host periodically
+	if ((++cycle % POLL_CYCLES) == 0)
+		Service (false);
+
+	// Update chip outputs
+	rxf_n = (rxcnt == 0);
+	txe_n = (txcnt == FT245_BUF_SZ);
+	*rxfn = rxf_n;
+	*txen = txe_n;
+	*data = rxbuf[rxhead];
+}
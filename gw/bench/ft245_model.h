@@ -0,0 +1,46 @@
+/**
+ *  Cycle model of the FT2232H synchronous FIFO (245) interface. Bytes are
+ *  bridged to a TCP socket so the host library can connect to a simulated
+ *  FT245 transport with TCPTransport.
+ *
+ *  All rights reserved.
+ *  Tiny Labs Inc
+ *  2022
+ */
+#ifndef FT245_MODEL_H
+#define FT245_MODEL_H
+
+#include <stdint.h>
+
+// FT2232H has 4K buffers in each direction
+#define FT245_BUF_SZ   4096
+
+class FT245Model {
+ private:
+	int srvfd, fd;
+	uint8_t rxbuf[FT245_BUF_SZ], txbuf[FT245_BUF_SZ];
+	int rxhead, rxcnt, txcnt;
+	int idle, cycle;
+
+	// Flags driven after last edge
+	bool rxf_n, txe_n;
+
+	// Transfers latched on current edge
+	bool do_rd, do_wr;
+	uint8_t wrdata;
+
+	void Accept (void);
+	void Service (bool flush);
+
+ public:
+	FT245Model (uint16_t port);
+	~FT245Model ();
+
+	// Call before rising edge with DUT outputs
+	void Sample (uint8_t rdn, uint8_t wrn, uint8_t oen, uint8_t siwun, uint8_t data);
+
+	// Call after rising edge to update chip outputs
+	void Drive (uint8_t *rxfn, uint8_t *txen, uint8_t *data);
+};
+
+#endif /* FT245_MODEL_H */
@@ -0,0 +1,219 @@
+/**
+ *  adiv5_retry bench - stub PHY answers WAIT a set number of times
+ *  before OK. Checks exactly one response reaches the requester and
+ *  WAITCNT counts every WAIT seen.
+ *
+ *  All rights reserved.
+ *  Tiny Labs Inc
+ *  2022
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <deque>
+
+#include "verilated.h"
+#include "Vadiv5_retry.h"
+
+// Response status - matches host adiv5_stat_t
+#define STAT_WAIT	2
+#define STAT_OK		4
+
+// Data returned with OK
+#define RESP_DATA	0x1234ABCD
+
+// Stub PHY command FIFO depth
+#define PHY_DEPTH	4
+
+// Idle cycles checked for stray responses
+#define IDLE_CYCLES	64
+
+// Cycles before giving up on a response
+#define TIMEOUT_CYCLES	1000
+
+vluint64_t main_time = 0;
+
+double sc_time_stamp () {
+	return main_time;
+}
+
+// Stub PHY - WAIT for first wait_left commands then OK
+static std::deque<uint64_t> phy_resp;
+static uint64_t phy_rddata;
+static int wait_left, phy_cmds;
+static uint64_t phy_last;
+
+static void tick (Vadiv5_retry *top)
+{
+	bool wr, rd;
+	uint64_t wrdata;
+
+	// Settle requester inputs then sample PHY side before edge
+	top->eval ();
+	wr = top->ADIv5_WREN && !top->ADIv5_WRFULL;
+	wrdata = top->ADIv5_WRDATA;
+	rd = top->ADIv5_RDEN && !top->ADIv5_RDEMPTY;
+
+	top->CLK = 1;
+	top->eval ();
+	main_time++;
+
+	// Answer accepted command
+	if (wr) {
+		phy_cmds++;
+		phy_last = wrdata;
+		if (wait_left) {
+			wait_left--;
+			phy_resp.push_back (STAT_WAIT);
+		}
+		else
+			phy_resp.push_back (((uint64_t)RESP_DATA << 3) | STAT_OK);
+	}
+
+	// Read data valid cycle after RDEN
+	if (rd) {
+		phy_rddata = phy_resp.front ();
+		phy_resp.pop_front ();
+	}
+	top->ADIv5_RDDATA = phy_rddata;
+	top->ADIv5_RDEMPTY = phy_resp.empty ();
+	top->ADIv5_WRFULL = phy_resp.size () >= PHY_DEPTH;
+
+	top->CLK = 0;
+	top->eval ();
+	main_time++;
+}
+
+// Read responses until idle - returns count, last in resp
+static int drain (Vadiv5_retry *top, uint64_t *resp)
+{
+	int i, cnt = 0;
+
+	for (i = 0; i < TIMEOUT_CYCLES; i++) {
+		top->eval ();
+		if (!top->RDEMPTY) {
+			top->RDEN = 1;
+			tick (top);
+			top->RDEN = 0;
+			tick (top);
+			*resp = top->RDDATA;
+			cnt++;
+			i = TIMEOUT_CYCLES - IDLE_CYCLES;
+		}
+		else
+			tick (top);
+	}
+	return cnt;
+}
+
+// Write one command once accepted
+static void send_cmd (Vadiv5_retry *top, uint64_t cmd, int waits)
+{
+	int i;
+
+	wait_left = waits;
+	phy_cmds = 0;
+	for (i = 0; top->WRFULL && (i < TIMEOUT_CYCLES); i++)
+		tick (top);
+	top->WRDATA = cmd;
+	top->WREN = 1;
+	tick (top);
+	top->WREN = 0;
+}
+
+// Issue one command with PHY WAITing waits times - returns responses
+// seen by requester, last in resp
+static int issue (Vadiv5_retry *top, uint64_t cmd, int waits, uint64_t *resp)
+{
+	send_cmd (top, cmd, waits);
+	return drain (top, resp);
+}
+
+static int check (Vadiv5_retry *top, int retry, int waits, int stat)
+{
+	int cnt, expect;
+	uint32_t waitcnt;
+	uint64_t resp = 0, cmd = 0x5A5A5A5A;
+
+	// Retries stop at RETRY - pass through returns first WAIT
+	expect = waits <= retry ? waits : retry + 1;
+	if (!retry)
+		expect = waits ? 1 : 0;
+
+	top->RETRY = retry;
+	tick (top);
+	waitcnt = top->WAITCNT;
+	cnt = issue (top, cmd, waits, &resp);
+	printf ("RETRY=%d WAITs=%d: responses=%d stat=%d WAITCNT+%u PHY cmds=%d\n",
+		retry, waits, cnt, (int)(resp & 7), top->WAITCNT - waitcnt, phy_cmds);
+	if ((cnt != 1) || ((int)(resp & 7) != stat) ||
+	    (top->WAITCNT - waitcnt != (uint32_t)expect) ||
+	    (phy_cmds != (retry ? expect + (stat == STAT_OK) : 1)) ||
+	    (phy_last != cmd) ||
+	    ((stat == STAT_OK) && ((resp >> 3) != RESP_DATA))) {
+		printf ("FAIL\n");
+		return 1;
+	}
+	return 0;
+}
+
+// RETRY raised with a pass-through response unread - the response must
+// still reach the requester and the new RETRY apply afterwards
+static int check_switch (Vadiv5_retry *top)
+{
+	int i, cnt;
+	uint64_t resp = 0;
+
+	top->RETRY = 0;
+	tick (top);
+	send_cmd (top, 0xA5A5A5A5, 1);
+	top->RETRY = 4;
+	for (i = 0; i < IDLE_CYCLES; i++)
+		tick (top);
+	cnt = drain (top, &resp);
+	printf ("RETRY 0=>4 with response pending: responses=%d stat=%d\n",
+		cnt, (int)(resp & 7));
+	if ((cnt != 1) || ((int)(resp & 7) != STAT_WAIT)) {
+		printf ("FAIL\n");
+		return 1;
+	}
+	return check (top, 4, 2, STAT_OK);
+}
+
+int main (int argc, char **argv, char **env)
+{
+	int i, fail = 0;
+
+	Verilated::commandArgs (argc, argv);
+	Vadiv5_retry *top = new Vadiv5_retry;
+
+	// Reset
+	top->CLK = 0;
+	top->RESETn = 0;
+	top->RETRY = 0;
+	top->WREN = 0;
+	top->RDEN = 0;
+	top->ADIv5_WRFULL = 0;
+	top->ADIv5_RDEMPTY = 1;
+	for (i = 0; i < 4; i++)
+		tick (top);
+	top->RESETn = 1;
+	tick (top);
+
+	// WAITs absorbed, single OK returned
+	fail |= check (top, 8, 3, STAT_OK);
+	fail |= check (top, 1, 1, STAT_OK);
+
+	// Retries exhausted - final WAIT returned
+	fail |= check (top, 2, 5, STAT_WAIT);
+
+	// Pass through - WAIT returned, still counted
+	fail |= check (top, 0, 1, STAT_WAIT);
+	fail |= check (top, 0, 0, STAT_OK);
+
+	// Mode change deferred until pass-through response read
+	fail |= check_switch (top);
+
+	delete top;
+	printf ("%s\n", fail ? "adiv5_retry: FAILED" : "adiv5_retry: PASSED");
+	return fail;
+}
@@ -21,7 +21,12 @@
 
 #include "Vflexsoc_debug.h"
 
+#ifdef TRANSPORT_FT245
+#include "ft245_model.h"
+#endif
+
 static bool done;
+static int ft245_port = 5555;
 
 #define RESET_TIME		4
 
@@ -47,6 +52,9 @@ static int parse_opt(int key, char *arg, struct argp_state *state)
 		state->child_inputs[0] = state->input;
 		break;
 	// Add parsing of custom options here
+	case 'f':
+		ft245_port = atoi(arg);
+		break;
 	}
 
 	return 0;
@@ -56,6 +64,7 @@ static int parse_args(int argc, char **argv, VerilatorUtils* utils)
 {
 	struct argp_option options[] = {
 		// Add custom options here
+		{ "ft245", 'f', "PORT", 0, "FT245 sync FIFO model port" },
 		{ 0 }
 	};
 	struct argp_child child_parsers[] = {
@@ -89,6 +98,12 @@ int main(int argc, char **argv, char **env)
     top->UART_RX = 1; // RX should be default high
 
 	top->trace(utils->tfp, 99);
+
+#ifdef TRANSPORT_FT245
+	FT245Model* ft245 = new FT245Model(ft245_port);
+	top->FT_RXFn = 1;
+	top->FT_TXEn = 1;
+#endif
     
 	while (utils->doCycle() && !done) {
 
@@ -97,6 +112,13 @@ int main(int argc, char **argv, char **env)
         top->RESETn = 1;
       
       top->eval();
+#ifdef TRANSPORT_FT245
+      // Chip outputs change after the edge, transfers latch before it
+      if (top->TRANSPORT_CLK)
+        ft245->Drive (&top->FT_RXFn, &top->FT_TXEn, &top->FT_DATA_IN);
+      else if (top->RESETn)
+        ft245->Sample (top->FT_RDn, top->FT_WRn, top->FT_OEn, top->FT_SIWUn, top->FT_DATA_OUT);
+#endif
       top->CLK = !top->CLK;
       top->PHY_CLK = !top->PHY_CLK;
       top->PHY_CLKn = !top->PHY_CLK;
@@ -106,6 +128,9 @@ int main(int argc, char **argv, char **env)
         utils->doUARTServer (top->UART_TX, &top->UART_RX);
 	}
     
+#ifdef TRANSPORT_FT245
+	delete ft245;
+#endif
 	delete utils;
 	exit(0);
 }
@@ -0,0 +1,132 @@
+/**
+ *  ADIv5 WAIT retry. Sits between the CSR/bridge mux and adiv5_mux.
+ *
+ *  RETRY=0: pass through, commands may be pipelined and WAIT is
+ *    returned to the requester as before.
+ *  RETRY=N: one command outstanding. A WAIT response is dropped and
+ *    the command reissued up to N times, so only OK, FAULT or the
+ *    final WAIT is returned.
+ *
+ *  RETRY is sampled only while no command is outstanding, so a change
+ *  with pass-through responses still unread takes effect once they
+ *  have been read.
+ *
+ *  Every WAIT response seen is counted in WAITCNT.
+ *
+ *  All rights reserved.
+ *  Tiny Labs Inc
+ *  2022
+ */
+
+module adiv5_retry
+  import adiv5_pkg::*;
+  (
+   input                                CLK,
+   input                                RESETn,
+   // Config/status
+   input [7:0]                          RETRY,
+   output logic [31:0]                  WAITCNT,
+   // Requester => retry
+   input [ADIv5_CMD_WIDTH-1:0]          WRDATA,
+   input                                WREN,
+   output                               WRFULL,
+   output [ADIv5_RESP_WIDTH-1:0]        RDDATA,
+   input                                RDEN,
+   output                               RDEMPTY,
+   // retry => PHY mux
+   output [ADIv5_CMD_WIDTH-1:0]         ADIv5_WRDATA,
+   output                               ADIv5_WREN,
+   input                                ADIv5_WRFULL,
+   input [ADIv5_RESP_WIDTH-1:0]         ADIv5_RDDATA,
+   output                               ADIv5_RDEN,
+   input                                ADIv5_RDEMPTY
+   );
+
+   // Response status - matches host adiv5_stat_t
+   localparam [2:0] STAT_WAIT = 3'd2;
+
+   logic [ADIv5_CMD_WIDTH-1:0]  cmd;
+   logic [ADIv5_RESP_WIDTH-1:0] resp;
+   logic [7:0]                  tries, retry, inflight;
+   logic                        hold, pending, valid, reissue, rden_d, resp_sel;
+
+   // Retry mode until outstanding command returned
+   assign hold = (retry != 0) | pending | valid;
+
+   // Requester side - single command when holding
+   assign WRFULL = hold ? (pending | valid | ADIv5_WRFULL) : ADIv5_WRFULL;
+   assign RDEMPTY = hold ? !valid : ADIv5_RDEMPTY;
+   assign RDDATA = resp_sel ? resp : ADIv5_RDDATA;
+
+   // PHY side - reissue held command or pass through
+   assign ADIv5_WRDATA = reissue ? cmd : WRDATA;
+   assign ADIv5_WREN = reissue ? !ADIv5_WRFULL :
+                       hold ? (WREN & !pending & !valid) : WREN;
+   assign ADIv5_RDEN = hold ? (pending & !reissue & !rden_d & !ADIv5_RDEMPTY) : RDEN;
+
+   always @(posedge CLK)
+     if (!RESETn)
+       begin
+          pending <= 0;
+          valid <= 0;
+          reissue <= 0;
+          rden_d <= 0;
+          resp_sel <= 0;
+          tries <= 0;
+          retry <= 0;
+          inflight <= 0;
+          WAITCNT <= 0;
+       end
+     else
+       begin
+          // Pass-through commands awaiting response
+          if (!hold)
+            inflight <= inflight + (WREN & !ADIv5_WRFULL) - (RDEN & !ADIv5_RDEMPTY);
+
+          // Switch mode only while idle - not as a pass-through write lands
+          if (!pending & !valid & (inflight == 0) & (hold | !WREN))
+            retry <= RETRY;
+
+          // Response valid cycle after read
+          rden_d <= ADIv5_RDEN;
+          if (rden_d && (ADIv5_RDDATA[2:0] == STAT_WAIT))
+            WAITCNT <= WAITCNT + 1;
+
+          // Track source of data returned to requester
+          if (RDEN)
+            resp_sel <= hold;
+
+          // Hold command for reissue
+          if (hold & WREN & !pending & !valid)
+            begin
+               cmd <= WRDATA;
+               pending <= 1;
+               tries <= 0;
+            end
+
+          // Reissue once PHY accepts
+          if (reissue & !ADIv5_WRFULL)
+            reissue <= 0;
+
+          // Retry WAIT else return response
+          if (pending & rden_d)
+            begin
+               if ((ADIv5_RDDATA[2:0] == STAT_WAIT) && (tries < retry))
+                 begin
+                    tries <= tries + 1;
+                    reissue <= 1;
+                 end
+               else
+                 begin
+                    resp <= ADIv5_RDDATA;
+                    valid <= 1;
+                    pending <= 0;
+                 end
+            end
+
+          // Requester consumed response
+          if (RDEN & valid)
+            valid <= 0;
+       end
+
+endmodule // adiv5_retry
@@ -102,6 +102,15 @@ module arty_top
                     .RESETn         (RESETn & tpll_locked & spll_locked),
                     .UART_TX        (UART_TX),
                     .UART_RX        (UART_RX),
+                    .FT_DATA_IN     (8'h00),
+                    .FT_DATA_OUT    (),
+                    .FT_DATA_OE     (),
+                    .FT_RXFn        (1'b1),
+                    .FT_TXEn        (1'b1),
+                    .FT_RDn         (),
+                    .FT_WRn         (),
+                    .FT_OEn         (),
+                    .FT_SIWUn       (),
                     .TCK            (TCK),
                     .TDI            (TDI),
                     .TDO            (TDO),
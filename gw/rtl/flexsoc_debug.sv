@@ -8,6 +8,7 @@
 
 
 module flexsoc_debug
+  #(parameter TRANSPORT = "UART") // UART or FT245
   (
    // Clock domains
    input  CLK,
@@ -20,6 +21,17 @@ module flexsoc_debug
    output UART_TX,
    input  UART_RX,
 
+   // FT2232H sync FIFO host interface (TRANSPORT=FT245)
+   input [7:0]  FT_DATA_IN,
+   output [7:0] FT_DATA_OUT,
+   output       FT_DATA_OE,
+   input        FT_RXFn,
+   input        FT_TXEn,
+   output       FT_RDn,
+   output       FT_WRn,
+   output       FT_OEn,
+   output       FT_SIWUn,
+
    // Hardware signals
    output TCK,
    output TDI,
@@ -49,6 +61,10 @@ module flexsoc_debug
    // Master <=> FIFO
    wire master_RDEN, master_WREN, master_WRFULL, master_RDEMPTY;
    wire [7:0] master_RDDATA, master_WRDATA;
+
+   // Command extensions <=> FIFO
+   wire ext_RDEN, ext_WREN, ext_WRFULL, ext_RDEMPTY;
+   wire [7:0] ext_RDDATA, ext_WRDATA;
    
    // FIFO <=> Transport
    wire trans_RDEN, trans_WREN, trans_WRFULL, trans_RDEMPTY;
@@ -63,7 +79,12 @@ module flexsoc_debug
 
    // Bridge AHB3 slave
    logic        bridge_ahb3_HRESP, bridge_ahb3_HSEL, bridge_ahb3_HREADYOUT;
-   logic [31:0] bridge_ahb3_HRDATA;
+   logic [31:0] bridge_ahb3_HRDATA, bridge_ahb3_HADDR;
+
+   // AP windows - per transfer AP and translated address
+   logic [1:0]  win_hit;
+   logic [7:0]  win_apsel, brg_apsel, brg_apsel_r;
+   logic        brg_dphase;
 
    // CSR compound assignments
    logic [ADIv5_CMD_WIDTH-1:0] csr_adiv5_wrdata;
@@ -88,6 +109,14 @@ module flexsoc_debug
    logic [ADIv5_RESP_WIDTH-1:0] mux_adiv5_rddata;
    logic                        mux_adiv5_rden;
    logic                        mux_adiv5_rdempty;
+
+   // WAIT retry => PHY
+   logic [ADIv5_CMD_WIDTH-1:0]  phy_adiv5_wrdata;
+   logic                        phy_adiv5_wren;
+   logic                        phy_adiv5_wrfull;
+   logic [ADIv5_RESP_WIDTH-1:0] phy_adiv5_rddata;
+   logic                        phy_adiv5_rden;
+   logic                        phy_adiv5_rdempty;
    
    // ADIv5 CSR logic
    logic [31:0]               adiv5_data;
@@ -117,11 +146,23 @@ module flexsoc_debug
 
    // Feed RW CSRs back
    assign jtag_n_swd_i = jtag_n_swd_o;
+   assign phy_div_i = phy_div_o;
+   assign adiv5_retry_i = adiv5_retry_o;
    assign bridge_en_i = bridge_en_o;
    assign apsel_i = apsel_o;
    assign seq_i = seq_o;
    assign irq_scan_i = irq_scan_o;
    assign irq_base_i = irq_base_o;
+   assign halt_watch_i = halt_watch_o;
+   assign win0_base_i = win0_base_o;
+   assign win0_mask_i = win0_mask_o;
+   assign win0_remap_i = win0_remap_o;
+   assign win0_ap_i = win0_ap_o;
+   assign win1_base_i = win1_base_o;
+   assign win1_mask_i = win1_mask_o;
+   assign win1_remap_i = win1_remap_o;
+   assign win1_ap_i = win1_ap_o;
+
    
    // Assign return path to last selection
    logic        csr_sel;
@@ -207,7 +248,118 @@ module flexsoc_debug
                   .p (),
                   .q (PHY_RESETn)
                   );
+
+   // PHY clock divider - 0 passes PHY_CLK/PHY_CLKn, N enables one
+   // PHY_CLK cycle in 2N for PHY_CLK/2N. Clocks are gated in a global
+   // buffer rather than muxed in fabric so both stay on clock routing
+   // and glitch free. Enable is held during reset so PHY resets see
+   // clocks. PHY_CLKn enable follows half a cycle later to keep its
+   // edge after PHY_CLK.
+   //
+   // Divider crosses into PHY_CLK with a req/ack toggle handshake. The
+   // held copy only changes once the last one was acked, so PHY_CLK
+   // always captures a stable bus. Captured every cycle in reset, where
+   // the clock enable is forced anyway.
+   logic [7:0] phy_div_hold, phy_div;
+   logic       phy_div_req, phy_div_ack;
+   logic       phy_div_ack_s1, phy_div_ack_s2, phy_div_req_s1, phy_div_req_s2;
+   logic [8:0] phy_cnt;
+   logic       phy_ce, phy_cen, phy_clk_gated, phy_clkn_gated;
+   always @(posedge CLK)
+     if (!SYS_RESETn)
+       begin
+          phy_div_hold <= 0;
+          phy_div_req <= 0;
+          phy_div_ack_s1 <= 0;
+          phy_div_ack_s2 <= 0;
+       end
+     else
+       begin
+          phy_div_ack_s1 <= phy_div_ack;
+          phy_div_ack_s2 <= phy_div_ack_s1;
+          if ((phy_div_req == phy_div_ack_s2) && (phy_div_o != phy_div_hold))
+            begin
+               phy_div_hold <= phy_div_o;
+               phy_div_req <= !phy_div_req;
+            end
+       end
+   always @(posedge PHY_CLK)
+     begin
+        phy_div_req_s1 <= phy_div_req;
+        phy_div_req_s2 <= phy_div_req_s1;
+        if (!PHY_RESETn || (phy_div_req_s2 != phy_div_ack))
+          begin
+             phy_div <= phy_div_hold;
+             phy_div_ack <= phy_div_req_s2;
+          end
+        if (!PHY_RESETn || (phy_div == 0))
+          begin
+             phy_cnt <= 0;
+             phy_ce <= 1;
+          end
+        else if (phy_cnt >= {phy_div, 1'b0} - 1)
+          begin
+             phy_cnt <= 0;
+             phy_ce <= 1;
+          end
+        else
+          begin
+             phy_cnt <= phy_cnt + 1;
+             phy_ce <= 0;
+          end
+     end
+   always @(posedge PHY_CLKn)
+     phy_cen <= phy_ce;
+
+`ifdef SYNTHESIS
+   BUFGCE u_phy_clk_gate  (.I (PHY_CLK),  .CE (phy_ce),  .O (phy_clk_gated));
+   BUFGCE u_phy_clkn_gate (.I (PHY_CLKn), .CE (phy_cen), .O (phy_clkn_gated));
+`else
+   // BUFGCE model - enable latched while clock low
+   logic phy_ce_l, phy_cen_l;
+   always_latch
+     if (!PHY_CLK)
+       phy_ce_l = phy_ce;
+   always_latch
+     if (!PHY_CLKn)
+       phy_cen_l = phy_cen;
+   assign phy_clk_gated = PHY_CLK & phy_ce_l;
+   assign phy_clkn_gated = PHY_CLKn & phy_cen_l;
+`endif
    
+   // AP windows - AP[8] enables, first hit wins, else APSEL CSR
+   assign win_hit[0] = win0_ap_o[8] & ((host_ahb3_HADDR & ~win0_mask_o) == win0_base_o);
+   assign win_hit[1] = win1_ap_o[8] & ((host_ahb3_HADDR & ~win1_mask_o) == win1_base_o);
+   always_comb
+     if (win_hit[0])
+       begin
+          win_apsel = win0_ap_o[7:0];
+          bridge_ahb3_HADDR = win0_remap_o | (host_ahb3_HADDR & win0_mask_o);
+       end
+     else if (win_hit[1])
+       begin
+          win_apsel = win1_ap_o[7:0];
+          bridge_ahb3_HADDR = win1_remap_o | (host_ahb3_HADDR & win1_mask_o);
+       end
+     else
+       begin
+          win_apsel = apsel_o;
+          bridge_ahb3_HADDR = host_ahb3_HADDR;
+       end
+
+   // Hold window AP through data phase then fall back to APSEL
+   // so IRQ scan/watch accesses use the default AP
+   always @(posedge CLK)
+     if (!SYS_RESETn)
+       brg_dphase <= 0;
+     else if (host_ahb3_HREADY)
+       begin
+          brg_dphase <= bridge_ahb3_HSEL;
+          brg_apsel_r <= win_apsel;
+       end
+   assign brg_apsel = (bridge_ahb3_HSEL & host_ahb3_HREADY) ? win_apsel :
+                      brg_dphase ? brg_apsel_r : apsel_o;
+
    // Convert host FIFO to AHB3
    ahb3lite_host_master
      u_host_master (
@@ -231,6 +383,26 @@ module flexsoc_debug
                     .WRDATA    (master_WRDATA)
                     );
 
+   // Expand extended host commands (FILL) and watch DHCSR
+   host_cmd_ext
+     u_cmd_ext (
+                .CLK            (CLK),
+                .RESETn         (SYS_RESETn),
+                .WATCH          (halt_watch_o & bridge_en_o),
+                .HOST_RDEN      (ext_RDEN),
+                .HOST_RDEMPTY   (ext_RDEMPTY),
+                .HOST_RDDATA    (ext_RDDATA),
+                .MASTER_RDEN    (master_RDEN),
+                .MASTER_RDEMPTY (master_RDEMPTY),
+                .MASTER_RDDATA  (master_RDDATA),
+                .MASTER_WREN    (master_WREN),
+                .MASTER_WRFULL  (master_WRFULL),
+                .MASTER_WRDATA  (master_WRDATA),
+                .HOST_WREN      (ext_WREN),
+                .HOST_WRFULL    (ext_WRFULL),
+                .HOST_WRDATA    (ext_WRDATA)
+                );
+
    // AHB3lite debug bridge
    ahb3lite_debug_bridge
      u_debug_bridge (
@@ -238,14 +410,14 @@ module flexsoc_debug
                      .RESETn        (SYS_RESETn),
                      .ENABLE        (bridge_en_o),
                      .STAT          (brg_adiv5_stat),
-                     .APSEL         (apsel_o),
+                     .APSEL         (brg_apsel),
                      .SEQ           (seq_o),
                      .IRQSCAN       (irq_scan_o),
                      .IRQCNT        (irq_cnt),
                      .IRQBASE       (irq_base_o),
                      // AHB3 interface
                      .HSEL          (bridge_ahb3_HSEL),
-                     .HADDR         (host_ahb3_HADDR),
+                     .HADDR         (bridge_ahb3_HADDR),
                      .HWDATA        (host_ahb3_HWDATA),
                      .HTRANS        (host_ahb3_HTRANS),
                      .HSIZE         (host_ahb3_HSIZE),
@@ -273,22 +445,43 @@ module flexsoc_debug
                      .IRQ_RDDATA    (irq_RDDATA)
                      );
 
+   // Retry WAIT responses before they reach CSR/bridge
+   adiv5_retry
+     u_adiv5_retry (
+                    .CLK           (CLK),
+                    .RESETn        (SYS_RESETn),
+                    .RETRY         (adiv5_retry_o),
+                    .WAITCNT       (adiv5_waits),
+                    .WRDATA        (mux_adiv5_wrdata),
+                    .WREN          (mux_adiv5_wren),
+                    .WRFULL        (mux_adiv5_wrfull),
+                    .RDDATA        (mux_adiv5_rddata),
+                    .RDEN          (mux_adiv5_rden),
+                    .RDEMPTY       (mux_adiv5_rdempty),
+                    .ADIv5_WRDATA  (phy_adiv5_wrdata),
+                    .ADIv5_WREN    (phy_adiv5_wren),
+                    .ADIv5_WRFULL  (phy_adiv5_wrfull),
+                    .ADIv5_RDDATA  (phy_adiv5_rddata),
+                    .ADIv5_RDEN    (phy_adiv5_rden),
+                    .ADIv5_RDEMPTY (phy_adiv5_rdempty)
+                    );
+
    // Debug MUX
    adiv5_mux
      u_adiv5_mux (
               .CLK           (CLK),
               .SYS_RESETn    (SYS_RESETn),
-              .PHY_CLK       (PHY_CLK),
-              .PHY_CLKn      (PHY_CLKn),
+              .PHY_CLK       (phy_clk_gated),
+              .PHY_CLKn      (phy_clkn_gated),
               .PHY_RESETn    (PHY_RESETn),
               .JTAGnSWD      (jtag_n_swd_o),
               // ADIv5 interface
-              .ADIv5_WRDATA  (mux_adiv5_wrdata),
-              .ADIv5_WREN    (mux_adiv5_wren),
-              .ADIv5_WRFULL  (mux_adiv5_wrfull),
-              .ADIv5_RDDATA  (mux_adiv5_rddata),
-              .ADIv5_RDEN    (mux_adiv5_rden),
-              .ADIv5_RDEMPTY (mux_adiv5_rdempty),
+              .ADIv5_WRDATA  (phy_adiv5_wrdata),
+              .ADIv5_WREN    (phy_adiv5_wren),
+              .ADIv5_WRFULL  (phy_adiv5_wrfull),
+              .ADIv5_RDDATA  (phy_adiv5_rddata),
+              .ADIv5_RDEN    (phy_adiv5_rden),
+              .ADIv5_RDEMPTY (phy_adiv5_rdempty),
               // PHY signals
               .TCK           (TCK),
               .TDI           (TDI),
@@ -306,9 +499,9 @@ module flexsoc_debug
    u_arb_rx (
              .CLK           (CLK),
              .RESETn        (SYS_RESETn),
-             .c1_rden       (master_RDEN),
-             .c1_rdempty    (master_RDEMPTY),
-             .c1_rddata     (master_RDDATA),
+             .c1_rden       (ext_RDEN),
+             .c1_rdempty    (ext_RDEMPTY),
+             .c1_rddata     (ext_RDDATA),
              .c2_rden       (irq_RDEN),
              .c2_rdempty    (irq_RDEMPTY),
              .c2_rddata     (irq_RDDATA),
@@ -327,9 +520,9 @@ module flexsoc_debug
              .CLK         (CLK),
              .RESETn      (SYS_RESETn),
              // AHB3 master response
-             .c1_wren     (master_WREN),
-             .c1_wrdata   (master_WRDATA),
-             .c1_wrfull   (master_WRFULL),
+             .c1_wren     (ext_WREN),
+             .c1_wrdata   (ext_WRDATA),
+             .c1_wrfull   (ext_WRFULL),
              // Async IRQ generator (debug_bridge)
              .c2_wren     (irq_WREN),
              .c2_wrdata   (irq_WRDATA),
@@ -376,23 +569,64 @@ module flexsoc_debug
   
  
    // Host transport
-   uart_fifo 
-     u_uart (
-             .CLK        (TRANSPORT_CLK),
-             .RESETn     (TRANSPORT_RESETn),
-             // UART interface
-             .TX_PIN     (UART_TX),
-             .RX_PIN     (UART_RX),
-             // FIFO interface
-             .FIFO_WREN  (trans_WREN),
-             .FIFO_FULL  (trans_WRFULL),
-             .FIFO_DOUT  (trans_WRDATA),
-             .FIFO_RDEN  (trans_RDEN),
-             .FIFO_EMPTY (trans_RDEMPTY),
-             .FIFO_DIN   (trans_RDDATA),
-             // Dropped bytes
-             .DROPPED    (dropped)
-             );
+   generate
+      if (TRANSPORT == "FT245")
+        begin : gen_ft245
+           ft245_fifo
+             u_ft245 (
+                      .CLK        (TRANSPORT_CLK),
+                      .RESETn     (TRANSPORT_RESETn),
+                      // FT245 interface
+                      .DATA_IN    (FT_DATA_IN),
+                      .DATA_OUT   (FT_DATA_OUT),
+                      .DATA_OE    (FT_DATA_OE),
+                      .RXFn       (FT_RXFn),
+                      .TXEn       (FT_TXEn),
+                      .RDn        (FT_RDn),
+                      .WRn        (FT_WRn),
+                      .OEn        (FT_OEn),
+                      .SIWUn      (FT_SIWUn),
+                      // FIFO interface
+                      .FIFO_WREN  (trans_WREN),
+                      .FIFO_FULL  (trans_WRFULL),
+                      .FIFO_DOUT  (trans_WRDATA),
+                      .FIFO_RDEN  (trans_RDEN),
+                      .FIFO_EMPTY (trans_RDEMPTY),
+                      .FIFO_DIN   (trans_RDDATA)
+                      );
+
+           // UART idle
+           assign UART_TX = 1;
+           assign dropped = 0;
+        end
+      else
+        begin : gen_uart
+           uart_fifo
+             u_uart (
+                     .CLK        (TRANSPORT_CLK),
+                     .RESETn     (TRANSPORT_RESETn),
+                     // UART interface
+                     .TX_PIN     (UART_TX),
+                     .RX_PIN     (UART_RX),
+                     // FIFO interface
+                     .FIFO_WREN  (trans_WREN),
+                     .FIFO_FULL  (trans_WRFULL),
+                     .FIFO_DOUT  (trans_WRDATA),
+                     .FIFO_RDEN  (trans_RDEN),
+                     .FIFO_EMPTY (trans_RDEMPTY),
+                     .FIFO_DIN   (trans_RDDATA),
+                     // Dropped bytes
+                     .DROPPED    (dropped)
+                     );
+
+           // FT245 idle
+           assign FT_DATA_OUT = 0;
+           assign FT_DATA_OE = 0;
+           assign FT_RDn = 1;
+           assign FT_WRn = 1;
+           assign FT_OEn = 1;
+           assign FT_SIWUn = 1;
+        end
+   endgenerate
 
-   
 endmodule // flexsoc_debug
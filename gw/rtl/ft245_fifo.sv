@@ -0,0 +1,160 @@
+/**
+ *  FT2232H synchronous FIFO (245) transport. Drop-in replacement for
+ *  uart_fifo - drives the same FIFO interface from channel A of the
+ *  FT2232H running in BITMODE_SYNCFF.
+ *
+ *  CLK must be the 60MHz CLKOUT from the FT2232H. DATA is split into
+ *  in/out/oe as Verilator doesn't handle INOUT nets.
+ *
+ *  All rights reserved.
+ *  Tiny Labs Inc
+ *  2022
+ */
+
+module ft245_fifo
+  #(parameter BURST = 64)
+  (
+   input        CLK,
+   input        RESETn,
+   // FT245 synchronous FIFO interface
+   input [7:0]  DATA_IN,
+   output [7:0] DATA_OUT,
+   output       DATA_OE,
+   input        RXFn,
+   input        TXEn,
+   output       RDn,
+   output       WRn,
+   output       OEn,
+   output       SIWUn,
+   // FIFO interface
+   output       FIFO_WREN,
+   input        FIFO_FULL,
+   output [7:0] FIFO_DOUT,
+   output       FIFO_RDEN,
+   input        FIFO_EMPTY,
+   input [7:0]  FIFO_DIN
+   );
+
+   // Bus direction state
+   typedef enum logic [1:0] {
+                             ST_IDLE  = 0,
+                             ST_RDOE  = 1, // Turn bus around before RD#
+                             ST_READ  = 2,
+                             ST_WRITE = 3
+                             } state_t;
+   state_t state;
+
+   // Two entry skid buffer to absorb FIFO read latency
+   logic [7:0]  txq[2];
+   logic [1:0]  txcnt;
+   logic        txpend;
+   logic        consume;
+
+   // Burst counter for fairness between directions
+   logic [$clog2(BURST)-1:0] burst;
+   logic                     rx_waiting, tx_waiting;
+
+   // Pending send immediate after write burst
+   logic                     dirty, siwu;
+
+   // Data is transferred on each edge where strobe and flag are both low
+   assign consume   = (state == ST_WRITE) & (txcnt != 0) & !TXEn;
+   assign rx_waiting = !RXFn & !FIFO_FULL;
+   assign tx_waiting = !TXEn & ((txcnt != 0) | txpend);
+
+   // Host => FIFO
+   assign OEn       = !((state == ST_RDOE) | (state == ST_READ));
+   assign RDn       = !((state == ST_READ) & !FIFO_FULL);
+   assign FIFO_WREN = !RDn & !RXFn;
+   assign FIFO_DOUT = DATA_IN;
+
+   // FIFO => Host
+   assign DATA_OE   = (state == ST_WRITE);
+   assign DATA_OUT  = txq[0];
+   assign WRn       = !((state == ST_WRITE) & (txcnt != 0));
+   assign FIFO_RDEN = !FIFO_EMPTY & (({1'b0, txcnt} + txpend - consume) < 2);
+   assign SIWUn     = !siwu;
+
+   // Skid buffer
+   always @(posedge CLK)
+     if (!RESETn)
+       begin
+          txcnt <= 0;
+          txpend <= 0;
+       end
+     else
+       begin
+          txpend <= FIFO_RDEN;
+          case ({txpend, consume})
+            2'b10: begin
+               txq[txcnt[0]] <= FIFO_DIN;
+               txcnt <= txcnt + 1;
+            end
+            2'b01: begin
+               txq[0] <= txq[1];
+               txcnt <= txcnt - 1;
+            end
+            2'b11: begin
+               if (txcnt == 1)
+                 txq[0] <= FIFO_DIN;
+               else
+                 begin
+                    txq[0] <= txq[1];
+                    txq[1] <= FIFO_DIN;
+                 end
+            end
+            default: ;
+          endcase
+       end
+
+   // Bus arbitration
+   always @(posedge CLK)
+     if (!RESETn)
+       begin
+          state <= ST_IDLE;
+          burst <= 0;
+          dirty <= 0;
+          siwu <= 0;
+       end
+     else
+       begin
+          siwu <= 0;
+          if (consume)
+            dirty <= 1;
+
+          case (state)
+            ST_IDLE:
+              begin
+                 burst <= 0;
+                 if (rx_waiting)
+                   state <= ST_RDOE;
+                 else if (tx_waiting)
+                   state <= ST_WRITE;
+                 // Flush short packet to host once response complete
+                 else if (dirty & FIFO_EMPTY & (txcnt == 0) & !txpend)
+                   begin
+                      siwu <= 1;
+                      dirty <= 0;
+                   end
+              end
+
+            ST_RDOE:
+              state <= ST_READ;
+
+            ST_READ:
+              begin
+                 burst <= burst + 1;
+                 if (RXFn | FIFO_FULL | (tx_waiting & (burst == BURST - 1)))
+                   state <= ST_IDLE;
+              end
+
+            ST_WRITE:
+              begin
+                 burst <= burst + 1;
+                 if (TXEn | ((txcnt == 0) & !txpend) | (rx_waiting & (burst == BURST - 1)))
+                   state <= ST_IDLE;
+              end
+          endcase
+       end
+
+endmodule // ft245_fifo
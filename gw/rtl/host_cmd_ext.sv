@@ -0,0 +1,530 @@
+/**
+ *  Host command extensions. Sits between the host FIFO and
+ *  ahb3lite_host_master and expands extended commands (width code 3)
+ *  into native master commands. Responses for expanded commands are
+ *  squashed back into a single status byte.
+ *
+ *  FILL: master | D16 | WRITE | 3
+ *    payload: ADDR[31:0] VALUE[31:0] COUNT[31:0] WIDTH[31:0] (big endian)
+ *    Writes VALUE COUNT times from ADDR using autoinc writes of WIDTH
+ *    bytes (1/2/4). COUNT must be non-zero. One write status returned
+ *    with the error bit ORed over all writes.
+ *
+ *  WAIT: master | D16 | READ | 3
+ *    payload: ADDR[31:0] MASK[31:0] VALUE[31:0] COUNT[31:0] (big endian)
+ *    Reads word at ADDR until (data & MASK) == VALUE, a read errors or
+ *    COUNT reads were issued. COUNT must be non-zero. Only the final
+ *    read response is returned so the host can queue commands behind
+ *    operations that complete asynchronously (ie. ADIv5 transfers).
+ *
+ *  WATCH: when enabled and the host is idle DHCSR is read every
+ *    WATCH_PERIOD cycles. If S_HALT, S_LOCKUP or S_RESET_ST changed an
+ *    async slave packet is sent: SLAVE | D4, DHCSR[31:0] (big endian).
+ *    Note S_RESET_ST is cleared by the read.
+ *
+ *  All rights reserved.
+ *  Tiny Labs Inc
+ *  2022
+ */
+
+module host_cmd_ext
+  #(parameter TAG_AWIDTH = 9,       // Max outstanding commands (log2)
+    parameter WATCH_PERIOD = 10000) // DHCSR poll interval (cycles)
+  (
+   input              CLK,
+   input              RESETn,
+   // Watch DHCSR for halt/lockup/reset
+   input              WATCH,
+   // Host FIFO => ext
+   output             HOST_RDEN,
+   input              HOST_RDEMPTY,
+   input [7:0]        HOST_RDDATA,
+   // ext => host master
+   input              MASTER_RDEN,
+   output             MASTER_RDEMPTY,
+   output logic [7:0] MASTER_RDDATA,
+   // host master => ext
+   input              MASTER_WREN,
+   output             MASTER_WRFULL,
+   input [7:0]        MASTER_WRDATA,
+   // ext => host FIFO
+   output             HOST_WREN,
+   input              HOST_WRFULL,
+   output [7:0]       HOST_WRDATA
+   );
+
+   // Must match host/flexsoc/flexsoc.cpp
+   localparam FIFO_D16 = 3'd7;
+   localparam CMD_EXT  = 2'd3;
+
+   // Watched DHCSR bits - S_RESET_ST, S_LOCKUP, S_HALT
+   localparam [31:0] DHCSR      = 32'hE000_EDF0;
+   localparam [31:0] WATCH_MASK = 32'h020A_0000;
+   localparam [7:0]  POLL_CMD   = 8'hB2; // master | D4 | READ | width 2
+   localparam [7:0]  WATCH_PKT  = 8'h30; // slave | D4
+
+   // Response tags
+   localparam TAG_PASS  = 2'd0;
+   localparam TAG_FILL  = 2'd1;
+   localparam TAG_WATCH = 2'd2;
+   localparam TAG_WAIT  = 2'd3;
+
+   // Payload length from command byte
+   function automatic [4:0] cmd2payload (input [7:0] cmd);
+      case (cmd[6:4])
+        3'd0: cmd2payload = 0;
+        3'd1: cmd2payload = 1;
+        3'd2: cmd2payload = 2;
+        3'd3: cmd2payload = 4;
+        3'd4: cmd2payload = 5;
+        3'd5: cmd2payload = 6;
+        3'd6: cmd2payload = 8;
+        3'd7: cmd2payload = 16;
+      endcase
+   endfunction
+
+   // Parser state
+   typedef enum logic [2:0] {
+                             ST_CMD   = 0,
+                             ST_PASS  = 1,
+                             ST_ARGS  = 2,
+                             ST_FILL  = 3,
+                             ST_WATCH = 4,
+                             ST_WAIT  = 5,
+                             ST_WPEND = 6
+                             } state_t;
+   state_t state;
+
+   //
+   // Input skid buffer - absorbs host FIFO read latency
+   //
+   logic [7:0] inq[2];
+   logic [1:0] incnt;
+   logic       inpend, in_pop;
+
+   assign HOST_RDEN = !HOST_RDEMPTY & (({1'b0, incnt} + inpend - in_pop) < 2);
+
+   always @(posedge CLK)
+     if (!RESETn)
+       begin
+          incnt <= 0;
+          inpend <= 0;
+       end
+     else
+       begin
+          inpend <= HOST_RDEN;
+          case ({inpend, in_pop})
+            2'b10: begin
+               inq[incnt[0]] <= HOST_RDDATA;
+               incnt <= incnt + 1;
+            end
+            2'b01: begin
+               inq[0] <= inq[1];
+               incnt <= incnt - 1;
+            end
+            2'b11: begin
+               if (incnt == 1)
+                 inq[0] <= HOST_RDDATA;
+               else
+                 begin
+                    inq[0] <= inq[1];
+                    inq[1] <= HOST_RDDATA;
+                 end
+            end
+            default: ;
+          endcase
+       end
+
+   //
+   // Output queue to host master
+   //
+   logic [7:0] outq[4];
+   logic [1:0] out_wr, out_rd;
+   logic [2:0] out_cnt;
+   logic       out_push, out_pop;
+   logic [7:0] out_data;
+
+   assign MASTER_RDEMPTY = (out_cnt == 0);
+   assign out_pop = MASTER_RDEN & !MASTER_RDEMPTY;
+
+   always @(posedge CLK)
+     if (!RESETn)
+       begin
+          out_wr <= 0;
+          out_rd <= 0;
+          out_cnt <= 0;
+       end
+     else
+       begin
+          if (out_push)
+            begin
+               outq[out_wr] <= out_data;
+               out_wr <= out_wr + 1;
+            end
+          if (out_pop)
+            begin
+               MASTER_RDDATA <= outq[out_rd];
+               out_rd <= out_rd + 1;
+            end
+          out_cnt <= out_cnt + out_push - out_pop;
+       end
+
+   //
+   // Response tags - one per command issued to master
+   // PASS=passthrough FILL=squash FILL responses WATCH=consume DHCSR
+   // WAIT=consume poll, forward final read
+   //
+   logic [1:0]            tags[1 << TAG_AWIDTH];
+   logic [TAG_AWIDTH-1:0] tag_wr, tag_rd;
+   logic [TAG_AWIDTH:0]   tag_cnt;
+   logic                  tag_push, tag_pop;
+   logic [1:0]            tag_din;
+   logic                  tag_full, tag_empty;
+
+   assign tag_full = tag_cnt[TAG_AWIDTH];
+   assign tag_empty = (tag_cnt == 0);
+
+   always @(posedge CLK)
+     if (!RESETn)
+       begin
+          tag_wr <= 0;
+          tag_rd <= 0;
+          tag_cnt <= 0;
+       end
+     else
+       begin
+          if (tag_push)
+            begin
+               tags[tag_wr] <= tag_din;
+               tag_wr <= tag_wr + 1;
+            end
+          if (tag_pop)
+            tag_rd <= tag_rd + 1;
+          tag_cnt <= tag_cnt + tag_push - tag_pop;
+       end
+
+   //
+   // Command parser
+   //
+   logic [7:0]   cmd;
+   logic [4:0]   rem;
+   logic [127:0] args;
+   logic [31:0]  fill_addr, fill_value, fill_cnt, fill_rem;
+   logic [2:0]   fill_width;
+   logic [3:0]   gen_idx;
+   logic [31:0]  wait_addr, wait_mask, wait_value, wait_rem;
+   logic         gen_first, fill_busy, fill_done;
+   logic         is_fill, is_wait, ext_wait, wait_done, wait_retry, out_space;
+
+   assign cmd = inq[0];
+   assign is_fill = cmd[7] & (cmd[6:4] == FIFO_D16) & cmd[3] & (cmd[1:0] == CMD_EXT);
+   assign is_wait = cmd[7] & (cmd[6:4] == FIFO_D16) & !cmd[3] & (cmd[1:0] == CMD_EXT);
+   assign out_space = (out_cnt != 4);
+
+   //
+   // DHCSR watch timer - only fires when host link idle
+   //
+   logic [$clog2(WATCH_PERIOD+1)-1:0] watch_timer;
+   logic                              watch_due, watch_go;
+
+   assign watch_due = WATCH & (watch_timer == 0);
+   assign watch_go = (state == ST_CMD) & watch_due & (incnt == 0) & !inpend &
+                     HOST_RDEMPTY & tag_empty & (out_cnt == 0) & !fill_busy;
+
+   always @(posedge CLK)
+     if (!RESETn | !WATCH | watch_go)
+       watch_timer <= WATCH_PERIOD;
+     else if (watch_timer != 0)
+       watch_timer <= watch_timer - 1;
+
+   // Generated write headers
+   logic [7:0] hdr_first, hdr_next;
+   always_comb
+     case (fill_width)
+       1:       begin hdr_first = 8'hC8; hdr_next = 8'h9C; end // D5/D1  width 0
+       2:       begin hdr_first = 8'hD9; hdr_next = 8'hAD; end // D6/D2  width 1
+       default: begin hdr_first = 8'hEA; hdr_next = 8'hBE; end // D8/D4  width 2
+     endcase
+
+   // Generated byte stream
+   // first: HDR ADDR[31:24] .. ADDR[7:0] VALUE
+   // next:  HDR VALUE
+   // watch: POLL_CMD DHCSR[31:24] .. DHCSR[7:0]
+   // wait:  POLL_CMD ADDR[31:24] .. ADDR[7:0]
+   logic [3:0] gen_len, vidx;
+   logic [7:0] gen_byte;
+   assign gen_len = gen_first ? 5 + fill_width : 1 + fill_width;
+   assign vidx = gen_first ? gen_idx - 5 : gen_idx - 1;
+   always_comb
+     if (state == ST_WATCH)
+       gen_byte = (gen_idx == 0) ? POLL_CMD : DHCSR[8 * (4 - gen_idx) +: 8];
+     else if (state == ST_WAIT)
+       gen_byte = (gen_idx == 0) ? POLL_CMD : wait_addr[8 * (4 - gen_idx) +: 8];
+     else if (gen_idx == 0)
+       gen_byte = gen_first ? hdr_first : hdr_next;
+     else if (gen_first & (gen_idx < 5))
+       gen_byte = fill_addr[8 * (4 - gen_idx) +: 8];
+     else
+       gen_byte = fill_value[8 * (fill_width - 1 - vidx) +: 8];
+
+   // Consume/produce
+   always_comb
+     begin
+        in_pop = 0;
+        out_push = 0;
+        out_data = cmd;
+        tag_push = 0;
+        tag_din = TAG_PASS;
+        case (state)
+          ST_CMD:
+            if (watch_go)
+              begin
+                 tag_push = 1;
+                 tag_din = TAG_WATCH;
+              end
+            else if (incnt != 0)
+              begin
+                 if (is_fill | is_wait)
+                   in_pop = !fill_busy;
+                 else if (out_space & !tag_full)
+                   begin
+                      in_pop = 1;
+                      out_push = 1;
+                      tag_push = 1;
+                   end
+              end
+          ST_PASS:
+            if ((incnt != 0) & out_space)
+              begin
+                 in_pop = 1;
+                 out_push = 1;
+              end
+          ST_ARGS:
+            if ((incnt != 0) & ((rem != 1) | !tag_full))
+              begin
+                 in_pop = 1;
+                 // Tag entire fill/first poll on last arg
+                 tag_push = (rem == 1);
+                 tag_din = ext_wait ? TAG_WAIT : TAG_FILL;
+              end
+          ST_FILL, ST_WATCH, ST_WAIT:
+            if (out_space)
+              begin
+                 out_push = 1;
+                 out_data = gen_byte;
+              end
+          ST_WPEND:
+            begin
+               // Poll again - WAIT tag already popped so never full
+               tag_push = wait_retry;
+               tag_din = TAG_WAIT;
+            end
+          default: ;
+        endcase
+     end
+
+   always @(posedge CLK)
+     if (!RESETn)
+       state <= ST_CMD;
+     else
+       case (state)
+         ST_CMD:
+           if (watch_go)
+             begin
+                gen_idx <= 0;
+                state <= ST_WATCH;
+             end
+           else if (in_pop)
+             begin
+                if (is_fill | is_wait)
+                  begin
+                     rem <= 16;
+                     ext_wait <= is_wait;
+                     state <= ST_ARGS;
+                  end
+                else if (cmd2payload (cmd) != 0)
+                  begin
+                     rem <= cmd2payload (cmd);
+                     state <= ST_PASS;
+                  end
+             end
+         ST_PASS:
+           if (in_pop)
+             begin
+                rem <= rem - 1;
+                if (rem == 1)
+                  state <= ST_CMD;
+             end
+         ST_ARGS:
+           if (in_pop)
+             begin
+                args <= {args[119:0], cmd};
+                rem <= rem - 1;
+                if ((rem == 1) & ext_wait)
+                  begin
+                     wait_addr <= args[119:88];
+                     wait_mask <= args[87:56];
+                     wait_value <= args[55:24];
+                     wait_rem <= {args[23:0], cmd};
+                     gen_idx <= 0;
+                     state <= ST_WAIT;
+                  end
+                else if (rem == 1)
+                  begin
+                     fill_addr <= args[119:88];
+                     fill_value <= args[87:56];
+                     fill_cnt <= args[55:24];
+                     fill_rem <= args[55:24];
+                     fill_width <= ({args[23:0], cmd} == 1) ? 1 :
+                                   ({args[23:0], cmd} == 2) ? 2 : 4;
+                     gen_idx <= 0;
+                     gen_first <= 1;
+                     state <= ST_FILL;
+                  end
+             end
+         ST_FILL:
+           if (out_push)
+             begin
+                gen_idx <= gen_idx + 1;
+                if (gen_idx == gen_len - 1)
+                  begin
+                     gen_idx <= 0;
+                     gen_first <= 0;
+                     fill_rem <= fill_rem - 1;
+                     if (fill_rem == 1)
+                       state <= ST_CMD;
+                  end
+             end
+         ST_WATCH, ST_WAIT:
+           if (out_push)
+             begin
+                gen_idx <= gen_idx + 1;
+                if (gen_idx == 4)
+                  state <= (state == ST_WAIT) ? ST_WPEND : ST_CMD;
+             end
+         ST_WPEND:
+           if (wait_retry)
+             begin
+                wait_rem <= wait_rem - 1;
+                gen_idx <= 0;
+                state <= ST_WAIT;
+             end
+           else if (wait_done)
+             state <= ST_CMD;
+         default:
+           state <= ST_CMD;
+       endcase
+
+   // Only one FILL in flight - released when status returned
+   always @(posedge CLK)
+     if (!RESETn)
+       fill_busy <= 0;
+     else if ((state == ST_ARGS) & in_pop & (rem == 1) & !ext_wait)
+       fill_busy <= 1;
+     else if (fill_done)
+       fill_busy <= 0;
+
+   //
+   // Response path
+   //
+   logic [4:0]  resp_rem;
+   logic [31:0] sq_rem;
+   logic        sq_act, sq_pkt, sq_err;
+   logic        resp_hdr, resp_sq, resp_wt, resp_emit, resp_last;
+   logic        wt_pkt, wt_err, wt_wait, wt_end, wt_hit;
+   logic [31:0] wt_data, wt_last, wt_word, ntf_data;
+   logic [7:0]  wt_hdr, ntf_hdr;
+   logic [2:0]  ntf_cnt;
+   logic [7:0]  ntf_byte;
+
+   // Hold master while DHCSR change or WAIT result sent
+   assign MASTER_WRFULL = HOST_WRFULL | (ntf_cnt != 0);
+   assign resp_hdr = (resp_rem == 0);
+   assign tag_pop = MASTER_WREN & resp_hdr & !sq_act & !tag_empty;
+   assign resp_sq = resp_hdr ? (sq_act | (tag_pop & (tags[tag_rd] == TAG_FILL))) : sq_pkt;
+   assign resp_wt = resp_hdr ? (tag_pop & ((tags[tag_rd] == TAG_WATCH) |
+                                           (tags[tag_rd] == TAG_WAIT))) : wt_pkt;
+   assign resp_last = resp_hdr & resp_sq & ((sq_act ? sq_rem : fill_cnt) == 1);
+   assign resp_emit = (!resp_sq | resp_last) & !resp_wt;
+   assign fill_done = MASTER_WREN & resp_last;
+
+   assign ntf_byte = (ntf_cnt == 5) ? ntf_hdr : ntf_data[8 * (ntf_cnt - 1) +: 8];
+   assign HOST_WREN = (ntf_cnt != 0) ? !HOST_WRFULL : MASTER_WREN & resp_emit;
+   assign HOST_WRDATA = (ntf_cnt != 0) ? ntf_byte :
+                        resp_last ? {MASTER_WRDATA[7:1], MASTER_WRDATA[0] | (sq_act & sq_err)} :
+                        MASTER_WRDATA;
+
+   always @(posedge CLK)
+     if (!RESETn)
+       begin
+          resp_rem <= 0;
+          sq_act <= 0;
+          sq_pkt <= 0;
+          sq_err <= 0;
+          wt_pkt <= 0;
+       end
+     else if (MASTER_WREN)
+       begin
+          if (resp_hdr)
+            begin
+               resp_rem <= cmd2payload (MASTER_WRDATA);
+               sq_pkt <= resp_sq;
+               wt_pkt <= resp_wt;
+               wt_wait <= tag_pop & (tags[tag_rd] == TAG_WAIT);
+               wt_hdr <= MASTER_WRDATA;
+               wt_err <= MASTER_WRDATA[0];
+               if (resp_sq)
+                 begin
+                    sq_act <= !resp_last;
+                    sq_rem <= (sq_act ? sq_rem : fill_cnt) - 1;
+                    sq_err <= (sq_act & sq_err) | MASTER_WRDATA[0];
+                 end
+            end
+          else
+            resp_rem <= resp_rem - 1;
+       end
+
+   //
+   // Consumed poll responses - notify host of DHCSR changes, forward
+   // final WAIT read or poll again
+   //
+   assign wt_word = {wt_data[23:0], MASTER_WRDATA};
+   assign wt_end = MASTER_WREN & !resp_hdr & wt_pkt & (resp_rem == 1);
+   assign wt_hit = wt_err | ((wt_word & wait_mask) == wait_value) | (wait_rem == 1);
+   assign wait_done = wt_end & wt_wait & wt_hit;
+   assign wait_retry = wt_end & wt_wait & !wt_hit;
+
+   always @(posedge CLK)
+     if (!RESETn)
+       begin
+          ntf_cnt <= 0;
+          wt_last <= 0;
+       end
+     else if (ntf_cnt != 0)
+       begin
+          if (!HOST_WRFULL)
+            ntf_cnt <= ntf_cnt - 1;
+       end
+     else
+       begin
+          // Restart from idle so first poll reports state
+          if (!WATCH)
+            wt_last <= 0;
+          if (MASTER_WREN & !resp_hdr & wt_pkt)
+            wt_data <= wt_word;
+          if (wait_done)
+            begin
+               ntf_hdr <= wt_hdr;
+               ntf_data <= wt_word;
+               ntf_cnt <= 5;
+            end
+          else if (wt_end & !wt_wait & !wt_err & (((wt_word ^ wt_last) & WATCH_MASK) != 0))
+            begin
+               wt_last <= wt_word;
+               ntf_hdr <= WATCH_PKT;
+               ntf_data <= wt_word;
+               ntf_cnt <= 5;
+            end
+       end
+
+endmodule // host_cmd_ext
@@ -27,49 +27,6 @@ static void shutdown (int sig)
   shutdown_flag = 1;  
 }
 
-static uint32_t *read_bin (const char *filename, long *size)
-{
-  FILE *fp;
-  long nsize, bread = 0;
-  uint32_t *buf;
-  int rv, i;
-  
-  // Open file
-  fp = fopen (filename, "rb");
-  if (!fp)
-    log (LOG_FATAL, "Failed to open: %s", filename);
-
-  // Get file size
-  fseek (fp, 0, SEEK_END);
-  *size = ftell (fp);
-  fseek (fp, 0, 0);
-  if (*size & 3)
-    nsize = *size + 4 - (*size & 3);
-  else
-    nsize = *size;
-  
-  // Malloc space
-  buf = (uint32_t *)malloc (nsize);
-  if (!buf)
-    log (LOG_FATAL, "Failed to malloc");
-  memset (buf, 0, nsize);
-  
-  // Read into buffer
-  while (bread < *size) {
-    rv = fread (&buf[bread], 1, *size - bread, fp);
-    if (rv <= 0)
-      log (LOG_FATAL, "IO error: %d", rv);
-    bread += rv;
-  }
-
-  // Return nsize
-  *size = nsize;
-  
-  // Close file and return
-  fclose (fp);
-  return buf;
-}
-
 int flexdbg (args_t *args)
 {
   Target *target;
@@ -98,6 +55,18 @@ int flexdbg (args_t *args)
   // Register handler for shutdown
   signal (SIGINT, &shutdown);
 
+  // Load images
+  if (args->load_cnt)
+    flexdbg_load (target, args);
+
+  // Profile running target
+  if (args->profile)
+    flexdbg_profile (target, args);
+
+  // Serve GDB until killed
+  if (args->gdb_port)
+    flexdbg_gdbserver (target, args);
+
   /*
   // Switch to SWD
   target->Mode (MODE_SWD);
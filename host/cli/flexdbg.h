@@ -19,9 +19,26 @@ typedef struct {
   char    *device;     // Device to connect to
   load_t  *load;       // List of files to load
   int     load_cnt;    // Number of files to load
+  uint32_t scratch;    // Target RAM for stubs (0=none)
+  bool    delta;       // Only load changed pages
+  int     gdb_port;    // GDB server port (0=off)
+  char    *flash;      // CMSIS .FLM for GDB flash programming (NULL=off)
+  char    *profile;    // ELF to profile against (NULL=off)
+  double  duration;    // Profile duration in seconds
+  char    *folded;     // Folded samples, one leaf frame per line
   int     verbose;     // 0=off 3=max
 } args_t;
 
 int flexdbg (args_t *args);
 
+// Load all images in args to target
+class Target;
+int flexdbg_load (Target *target, args_t *args);
+
+// Sample PC of running target and print flat profile
+int flexdbg_profile (Target *target, args_t *args);
+
+// Serve GDB remote protocol - flash programmed through args->flash .FLM
+int flexdbg_gdbserver (Target *target, args_t *args);
+
 #endif /* FLEXDBG_H */
@@ -0,0 +1,753 @@
+/**
+ * GDB remote serial protocol server
+ *
+ * Memory packets map straight onto the pipelined bridge read/write
+ * paths so a large PacketSize is advertised. Registers are read and
+ * written as a single batch.
+ *
+ * All rights reserved.
+ * Tiny Labs Inc
+ * 2022
+ */
+
+#include "flexdbg.h"
+
+#include "Target.h"
+#include "Debug.h"
+#include "Flash.h"
+#include "log.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/select.h>
+
+// Max packet payload - memory data + framing
+#define GDB_PACKET_SZ  (64 * 1024)
+
+// Halt wait between ^C checks while running
+#define GDB_POLL_MS    10
+
+// Stack for flash algorithm - scratch holds blob + 2 pages + stack
+#define GDB_FLASH_STACK  1024
+
+// Registers in target description order - g/G/p/P numbering
+#define GDB_REGS       17
+static const reg_t gdb_regs[GDB_REGS] = {
+  REG_R0, REG_R1, REG_R2, REG_R3, REG_R4, REG_R5, REG_R6, REG_R7,
+  REG_R8, REG_R9, REG_R10, REG_R11, REG_R12, REG_SP, REG_LR, REG_PC,
+  REG_xPSR
+};
+
+static const char target_xml[] =
+  "<?xml version=\"1.0\"?>"
+  "<!DOCTYPE target SYSTEM \"gdb-target.dtd\">"
+  "<target><architecture>arm</architecture>"
+  "<feature name=\"org.gnu.gdb.arm.m-profile\">"
+  "<reg name=\"r0\" bitsize=\"32\"/><reg name=\"r1\" bitsize=\"32\"/>"
+  "<reg name=\"r2\" bitsize=\"32\"/><reg name=\"r3\" bitsize=\"32\"/>"
+  "<reg name=\"r4\" bitsize=\"32\"/><reg name=\"r5\" bitsize=\"32\"/>"
+  "<reg name=\"r6\" bitsize=\"32\"/><reg name=\"r7\" bitsize=\"32\"/>"
+  "<reg name=\"r8\" bitsize=\"32\"/><reg name=\"r9\" bitsize=\"32\"/>"
+  "<reg name=\"r10\" bitsize=\"32\"/><reg name=\"r11\" bitsize=\"32\"/>"
+  "<reg name=\"r12\" bitsize=\"32\"/>"
+  "<reg name=\"sp\" bitsize=\"32\" type=\"data_ptr\"/>"
+  "<reg name=\"lr\" bitsize=\"32\"/>"
+  "<reg name=\"pc\" bitsize=\"32\" type=\"code_ptr\"/>"
+  "<reg name=\"xpsr\" bitsize=\"32\"/>"
+  "</feature></target>";
+
+// Server state
+typedef struct {
+  Target *target;
+  Debug *debug;
+  Flash *flash;
+  const flash_algo_t *algo;
+  int fd;
+  bool noack;
+
+  // Receive buffer
+  uint8_t rx[GDB_PACKET_SZ];
+  int rx_len, rx_off;
+
+  // Packet buffers
+  char pkt[GDB_PACKET_SZ];
+  char out[GDB_PACKET_SZ];
+  uint8_t mem[GDB_PACKET_SZ];
+
+  // vFlashWrite staging - programmed on vFlashDone
+  uint8_t *fbuf;
+  uint32_t faddr, flen;
+
+  // Write throughput of consecutive X/M packets
+  uint32_t wbytes;
+  struct timespec wstart;
+} gdb_t;
+
+static const char hexchars[] = "0123456789abcdef";
+
+static int hex (char c)
+{
+  if ((c >= '0') && (c <= '9'))
+    return c - '0';
+  if ((c >= 'a') && (c <= 'f'))
+    return c - 'a' + 10;
+  if ((c >= 'A') && (c <= 'F'))
+    return c - 'A' + 10;
+  return -1;
+}
+
+static int hex2bin (const char *in, uint8_t *out, int cnt)
+{
+  int i, hi, lo;
+
+  for (i = 0; i < cnt; i++) {
+    hi = hex (in[i * 2]);
+    lo = hex (in[(i * 2) + 1]);
+    if ((hi < 0) || (lo < 0))
+      return -1;
+    out[i] = (hi << 4) | lo;
+  }
+  return 0;
+}
+
+static void bin2hex (const uint8_t *in, char *out, int cnt)
+{
+  int i;
+
+  for (i = 0; i < cnt; i++) {
+    out[i * 2] = hexchars[in[i] >> 4];
+    out[(i * 2) + 1] = hexchars[in[i] & 0xF];
+  }
+  out[cnt * 2] = '\0';
+}
+
+// Little endian word as hex
+static void word2hex (uint32_t val, char *out)
+{
+  uint8_t b[4] = {(uint8_t)val, (uint8_t)(val >> 8),
+                  (uint8_t)(val >> 16), (uint8_t)(val >> 24)};
+  bin2hex (b, out, 4);
+}
+
+static int hex2word (const char *in, uint32_t *val)
+{
+  uint8_t b[4];
+
+  if (hex2bin (in, b, 4))
+    return -1;
+  *val = b[0] | (b[1] << 8) | (b[2] << 16) | (b[3] << 24);
+  return 0;
+}
+
+// Parse "addr,len" - returns pointer past len
+static const char *parse_range (const char *p, uint32_t *addr, uint32_t *len)
+{
+  char *end;
+
+  *addr = strtoul (p, &end, 16);
+  if (*end != ',')
+    return NULL;
+  *len = strtoul (end + 1, &end, 16);
+  return end;
+}
+
+//
+// Socket I/O
+//
+static int gdb_getc (gdb_t *gdb)
+{
+  if (gdb->rx_off == gdb->rx_len) {
+    gdb->rx_len = recv (gdb->fd, gdb->rx, sizeof (gdb->rx), 0);
+    gdb->rx_off = 0;
+    if (gdb->rx_len <= 0)
+      return -1;
+  }
+  return gdb->rx[gdb->rx_off++];
+}
+
+// Check for ^C while target running
+static bool gdb_interrupted (gdb_t *gdb)
+{
+  fd_set fds;
+  struct timeval tv = {0, 0};
+
+  if (gdb->rx_off == gdb->rx_len) {
+    FD_ZERO (&fds);
+    FD_SET (gdb->fd, &fds);
+    if (select (gdb->fd + 1, &fds, NULL, NULL, &tv) <= 0)
+      return false;
+  }
+  return gdb_getc (gdb) == 0x03;
+}
+
+static void gdb_send (gdb_t *gdb, const char *data)
+{
+  int len, i;
+  uint8_t sum = 0;
+  char *buf;
+
+  // $data#cs
+  len = strlen (data);
+  buf = (char *)malloc (len + 4);
+  if (!buf)
+    log (LOG_FATAL, "Malloc failed!");
+  buf[0] = '$';
+  for (i = 0; i < len; i++)
+    sum += data[i];
+  memcpy (&buf[1], data, len);
+  buf[len + 1] = '#';
+  buf[len + 2] = hexchars[sum >> 4];
+  buf[len + 3] = hexchars[sum & 0xF];
+  log (LOG_TRACE, "gdb <= %s", data);
+
+  // Resend until acked
+  do {
+    if (send (gdb->fd, buf, len + 4, 0) != len + 4)
+      break;
+  } while (!gdb->noack && (gdb_getc (gdb) == '-'));
+  free (buf);
+}
+
+// Receive next packet into gdb->pkt - returns length or -1 on close
+static int gdb_recv (gdb_t *gdb)
+{
+  int c, len;
+  uint8_t sum, csum;
+
+  while (1) {
+
+    // Wait for start of packet
+    do {
+      c = gdb_getc (gdb);
+      if (c < 0)
+        return -1;
+    } while (c != '$');
+
+    // Read payload - binary data is escaped
+    for (len = 0, sum = 0; ; len++) {
+      c = gdb_getc (gdb);
+      if (c < 0)
+        return -1;
+      if ((c == '#') || (len == GDB_PACKET_SZ - 1))
+        break;
+      sum += c;
+      gdb->pkt[len] = c;
+    }
+    gdb->pkt[len] = '\0';
+    csum = hex (gdb_getc (gdb)) << 4;
+    csum |= hex (gdb_getc (gdb));
+
+    if (gdb->noack)
+      break;
+    if (csum == sum) {
+      send (gdb->fd, "+", 1, 0);
+      break;
+    }
+    send (gdb->fd, "-", 1, 0);
+  }
+  log (LOG_TRACE, "gdb => %.*s", len > 64 ? 64 : len, gdb->pkt);
+  return len;
+}
+
+//
+// Packet handlers
+//
+static void gdb_error (gdb_t *gdb, int err)
+{
+  sprintf (gdb->out, "E%02x", err & 0xFF);
+  gdb_send (gdb, gdb->out);
+}
+
+// Report MB/s once a run of memory writes finishes
+static void gdb_write_done (gdb_t *gdb)
+{
+  struct timespec end;
+  double secs;
+
+  if (!gdb->wbytes)
+    return;
+  clock_gettime (CLOCK_MONOTONIC, &end);
+  secs = (end.tv_sec - gdb->wstart.tv_sec) +
+    ((end.tv_nsec - gdb->wstart.tv_nsec) / 1e9);
+  log (LOG_NORMAL, "GDB wrote %u bytes in %.3fs (%.3f MB/s)", gdb->wbytes,
+       secs, (gdb->wbytes / (1024.0 * 1024.0)) / secs);
+  gdb->wbytes = 0;
+}
+
+static void gdb_write_mem (gdb_t *gdb, uint32_t addr, const uint8_t *data, uint32_t len)
+{
+  if (!gdb->wbytes)
+    clock_gettime (CLOCK_MONOTONIC, &gdb->wstart);
+  gdb->wbytes += len;
+  if (gdb->debug->WriteMem (addr, data, len))
+    gdb_error (gdb, 1);
+  else
+    gdb_send (gdb, "OK");
+}
+
+// Undo binary escaping in place - returns new length
+static int gdb_unescape (uint8_t *data, int len)
+{
+  int i, j;
+
+  for (i = 0, j = 0; i < len; i++, j++) {
+    if ((data[i] == '}') && (i + 1 < len))
+      data[j] = data[++i] ^ 0x20;
+    else
+      data[j] = data[i];
+  }
+  return j;
+}
+
+// Send slice of static document for qXfer
+static void gdb_xfer (gdb_t *gdb, const char *doc, const char *args)
+{
+  uint32_t off, len, sz = strlen (doc);
+
+  if (!parse_range (args, &off, &len)) {
+    gdb_error (gdb, 0);
+    return;
+  }
+  if (off >= sz) {
+    gdb_send (gdb, "l");
+    return;
+  }
+  len = len > GDB_PACKET_SZ - 2 ? GDB_PACKET_SZ - 2 : len;
+  len = (off + len) > sz ? sz - off : len;
+  gdb->out[0] = ((off + len) == sz) ? 'l' : 'm';
+  memcpy (&gdb->out[1], &doc[off], len);
+  gdb->out[len + 1] = '\0';
+  gdb_send (gdb, gdb->out);
+}
+
+static void gdb_memory_map (gdb_t *gdb, const char *args)
+{
+  char map[512];
+  const flash_algo_t *a = gdb->algo;
+  uint64_t end = (uint64_t)a->flash_start + a->flash_size;
+
+  // RAM either side of flash so nothing is inaccessible
+  snprintf (map, sizeof (map),
+            "<?xml version=\"1.0\"?>"
+            "<!DOCTYPE memory-map PUBLIC \"+//IDN gnu.org//DTD GDB Memory Map V1.0//EN\" "
+            "\"http://sourceware.org/gdb/gdb-memory-map.dtd\">"
+            "<memory-map>"
+            "<memory type=\"ram\" start=\"0x0\" length=\"0x%x\"/>"
+            "<memory type=\"flash\" start=\"0x%x\" length=\"0x%x\">"
+            "<property name=\"blocksize\">0x%x</property></memory>"
+            "<memory type=\"ram\" start=\"0x%llx\" length=\"0x%llx\"/>"
+            "</memory-map>",
+            a->flash_start, a->flash_start, a->flash_size, a->sector_size,
+            (unsigned long long)end, (unsigned long long)(0x100000000ULL - end));
+
+  // Empty leading region not allowed
+  if (!a->flash_start) {
+    char *p = strstr (map, "<memory type=\"ram\" start=\"0x0\"");
+    memmove (p, strchr (p, '>') + 1, strlen (strchr (p, '>') + 1) + 1);
+  }
+  gdb_xfer (gdb, map, args);
+}
+
+static void gdb_query (gdb_t *gdb)
+{
+  const char *p = gdb->pkt;
+
+  if (!strncmp (p, "qSupported", 10)) {
+    sprintf (gdb->out, "PacketSize=%x;QStartNoAckMode+;qXfer:features:read+%s",
+             GDB_PACKET_SZ - 16, gdb->algo ? ";qXfer:memory-map:read+" : "");
+    gdb_send (gdb, gdb->out);
+  }
+  else if (!strncmp (p, "qXfer:features:read:target.xml:", 31))
+    gdb_xfer (gdb, target_xml, &p[31]);
+  else if (gdb->algo && !strncmp (p, "qXfer:memory-map:read::", 23))
+    gdb_memory_map (gdb, &p[23]);
+  else if (!strcmp (p, "qAttached"))
+    gdb_send (gdb, "1");
+  else if (!strcmp (p, "qC"))
+    gdb_send (gdb, "QC1");
+  else if (!strcmp (p, "qfThreadInfo"))
+    gdb_send (gdb, "m1");
+  else if (!strcmp (p, "qsThreadInfo"))
+    gdb_send (gdb, "l");
+  else
+    gdb_send (gdb, "");
+}
+
+static void gdb_read_regs (gdb_t *gdb)
+{
+  int i;
+  uint32_t val[DEBUG_CORE_REGS];
+
+  // Single batch for whole core context
+  if (gdb->debug->ReadAllRegs (val, false)) {
+    gdb_error (gdb, 1);
+    return;
+  }
+  for (i = 0; i < GDB_REGS; i++)
+    word2hex (val[i], &gdb->out[i * 8]);
+  gdb_send (gdb, gdb->out);
+}
+
+static void gdb_write_regs (gdb_t *gdb)
+{
+  int i;
+  uint32_t val[GDB_REGS];
+
+  for (i = 0; i < GDB_REGS; i++)
+    if (hex2word (&gdb->pkt[1 + (i * 8)], &val[i])) {
+      gdb_error (gdb, 0);
+      return;
+    }
+  if (gdb->debug->RegWriteMulti (gdb_regs, val, GDB_REGS))
+    gdb_error (gdb, 1);
+  else
+    gdb_send (gdb, "OK");
+}
+
+static void gdb_read_reg (gdb_t *gdb)
+{
+  uint32_t n, val;
+
+  n = strtoul (&gdb->pkt[1], NULL, 16);
+  if (n >= GDB_REGS)
+    gdb_error (gdb, 0);
+  else if (gdb->debug->RegRead (gdb_regs[n], &val))
+    gdb_error (gdb, 1);
+  else {
+    word2hex (val, gdb->out);
+    gdb_send (gdb, gdb->out);
+  }
+}
+
+static void gdb_write_reg (gdb_t *gdb)
+{
+  char *p;
+  uint32_t n, val;
+
+  n = strtoul (&gdb->pkt[1], &p, 16);
+  if ((n >= GDB_REGS) || (*p != '=') || hex2word (p + 1, &val))
+    gdb_error (gdb, 0);
+  else if (gdb->debug->RegWrite (gdb_regs[n], val))
+    gdb_error (gdb, 1);
+  else
+    gdb_send (gdb, "OK");
+}
+
+static void gdb_read_mem (gdb_t *gdb)
+{
+  uint32_t addr, len;
+
+  if (!parse_range (&gdb->pkt[1], &addr, &len)) {
+    gdb_error (gdb, 0);
+    return;
+  }
+  len = len > (GDB_PACKET_SZ / 2) - 1 ? (GDB_PACKET_SZ / 2) - 1 : len;
+  if (gdb->debug->ReadMem (addr, gdb->mem, len)) {
+    gdb_error (gdb, 1);
+    return;
+  }
+  bin2hex (gdb->mem, gdb->out, len);
+  gdb_send (gdb, gdb->out);
+}
+
+static void gdb_hex_write (gdb_t *gdb)
+{
+  uint32_t addr, len;
+  const char *p;
+
+  p = parse_range (&gdb->pkt[1], &addr, &len);
+  if (!p || (*p != ':') || (len > sizeof (gdb->mem)) ||
+      hex2bin (p + 1, gdb->mem, len)) {
+    gdb_error (gdb, 0);
+    return;
+  }
+  gdb_write_mem (gdb, addr, gdb->mem, len);
+}
+
+static void gdb_bin_write (gdb_t *gdb, int plen)
+{
+  uint32_t addr, len;
+  const char *p;
+  int off;
+
+  p = parse_range (&gdb->pkt[1], &addr, &len);
+  if (!p || (*p != ':')) {
+    gdb_error (gdb, 0);
+    return;
+  }
+  off = p + 1 - gdb->pkt;
+  if ((int)len != gdb_unescape ((uint8_t *)&gdb->pkt[off], plen - off)) {
+    gdb_error (gdb, 0);
+    return;
+  }
+  gdb_write_mem (gdb, addr, (uint8_t *)&gdb->pkt[off], len);
+}
+
+// Wait for halt or ^C
+static void gdb_continue (gdb_t *gdb)
+{
+  gdb->debug->Resume ();
+  while (gdb->debug->WaitHalt (GDB_POLL_MS) == -ERR_TIMEOUT) {
+    if (gdb_interrupted (gdb)) {
+      gdb->debug->Halt (false);
+      gdb_send (gdb, "S02");
+      return;
+    }
+  }
+  gdb_send (gdb, "S05");
+}
+
+//
+// Flash programming - vFlashErase erases at once, writes are staged
+// into one page aligned image and programmed on vFlashDone
+//
+static void gdb_flash_erase (gdb_t *gdb)
+{
+  uint32_t addr, len;
+
+  if (!parse_range (&gdb->pkt[12], &addr, &len)) {
+    gdb_error (gdb, 0);
+    return;
+  }
+  if (gdb->flash->Erase (addr, len))
+    gdb_error (gdb, 1);
+  else
+    gdb_send (gdb, "OK");
+}
+
+static void gdb_flash_write (gdb_t *gdb, int plen)
+{
+  char *end;
+  uint8_t *buf;
+  uint32_t addr, len, lo, hi;
+  const flash_algo_t *algo = gdb->algo;
+  int off;
+
+  addr = strtoul (&gdb->pkt[12], &end, 16);
+  if (*end != ':') {
+    gdb_error (gdb, 0);
+    return;
+  }
+  off = end + 1 - gdb->pkt;
+  len = gdb_unescape ((uint8_t *)&gdb->pkt[off], plen - off);
+  if ((addr < algo->flash_start) ||
+      (addr + len > algo->flash_start + algo->flash_size)) {
+    gdb_error (gdb, 1);
+    return;
+  }
+
+  // Grow image to cover write - gaps stay erased so each page is only
+  // programmed once however the runs are split
+  lo = addr - ((addr - algo->flash_start) % algo->page_size);
+  hi = addr + len;
+  if (gdb->flen) {
+    lo = lo < gdb->faddr ? lo : gdb->faddr;
+    hi = hi > gdb->faddr + gdb->flen ? hi : gdb->faddr + gdb->flen;
+  }
+  if (gdb->flen && (lo == gdb->faddr)) {
+    buf = (uint8_t *)realloc (gdb->fbuf, hi - lo);
+    if (!buf) {
+      gdb_error (gdb, 1);
+      return;
+    }
+    memset (&buf[gdb->flen], algo->erased, (hi - lo) - gdb->flen);
+  }
+  else {
+    buf = (uint8_t *)malloc (hi - lo);
+    if (!buf) {
+      gdb_error (gdb, 1);
+      return;
+    }
+    memset (buf, algo->erased, hi - lo);
+    if (gdb->flen)
+      memcpy (&buf[gdb->faddr - lo], gdb->fbuf, gdb->flen);
+    free (gdb->fbuf);
+  }
+  gdb->fbuf = buf;
+  gdb->faddr = lo;
+  gdb->flen = hi - lo;
+  memcpy (&gdb->fbuf[addr - lo], &gdb->pkt[off], len);
+  gdb_send (gdb, "OK");
+}
+
+static void gdb_flash_done (gdb_t *gdb)
+{
+  int rv = 0;
+  struct timespec start, end;
+  double secs;
+
+  if (gdb->flen) {
+    clock_gettime (CLOCK_MONOTONIC, &start);
+    rv = gdb->flash->Program (gdb->faddr, gdb->fbuf, gdb->flen, false);
+    clock_gettime (CLOCK_MONOTONIC, &end);
+    secs = (end.tv_sec - start.tv_sec) + ((end.tv_nsec - start.tv_nsec) / 1e9);
+    log (LOG_NORMAL, "GDB flashed %u bytes in %.3fs (%.3f KB/s)", gdb->flen,
+         secs, (gdb->flen / 1024.0) / secs);
+  }
+  free (gdb->fbuf);
+  gdb->fbuf = NULL;
+  gdb->flen = 0;
+  if (rv)
+    gdb_error (gdb, 1);
+  else
+    gdb_send (gdb, "OK");
+}
+
+static void gdb_v (gdb_t *gdb, int plen)
+{
+  const char *p = gdb->pkt;
+
+  if (gdb->flash && !strncmp (p, "vFlashErase:", 12))
+    gdb_flash_erase (gdb);
+  else if (gdb->flash && !strncmp (p, "vFlashWrite:", 12))
+    gdb_flash_write (gdb, plen);
+  else if (gdb->flash && !strcmp (p, "vFlashDone"))
+    gdb_flash_done (gdb);
+  else if (!strncmp (p, "vKill", 5))
+    gdb_send (gdb, "OK");
+  else
+    gdb_send (gdb, "");
+}
+
+// Serve one connection - returns when gdb detaches
+static void gdb_session (gdb_t *gdb)
+{
+  int len;
+
+  gdb->noack = false;
+  gdb->rx_len = gdb->rx_off = 0;
+  while ((len = gdb_recv (gdb)) >= 0) {
+
+    // Finish write benchmark on first non write
+    if ((gdb->pkt[0] != 'X') && (gdb->pkt[0] != 'M'))
+      gdb_write_done (gdb);
+
+    switch (gdb->pkt[0]) {
+      case '?': gdb_send (gdb, "S05"); break;
+      case 'g': gdb_read_regs (gdb); break;
+      case 'G': gdb_write_regs (gdb); break;
+      case 'p': gdb_read_reg (gdb); break;
+      case 'P': gdb_write_reg (gdb); break;
+      case 'm': gdb_read_mem (gdb); break;
+      case 'M': gdb_hex_write (gdb); break;
+      case 'X': gdb_bin_write (gdb, len); break;
+      case 'c': gdb_continue (gdb); break;
+      case 'H': gdb_send (gdb, "OK"); break;
+      case 'q': gdb_query (gdb); break;
+      case 'v': gdb_v (gdb, len); break;
+      case 's':
+        if (gdb->debug->Step ())
+          gdb_error (gdb, 1);
+        else
+          gdb_send (gdb, "S05");
+        break;
+      case 'Q':
+        if (!strcmp (gdb->pkt, "QStartNoAckMode")) {
+          gdb_send (gdb, "OK");
+          gdb->noack = true;
+        }
+        else
+          gdb_send (gdb, "");
+        break;
+      case 'D':
+        gdb_send (gdb, "OK");
+        gdb->debug->Run ();
+        return;
+      case 'k':
+        return;
+      default:
+        gdb_send (gdb, "");
+        break;
+    }
+  }
+}
+
+int flexdbg_gdbserver (Target *target, args_t *args)
+{
+  int srv, one = 1, rv;
+  struct sockaddr_in sa;
+  flash_algo_t *algo = NULL;
+  gdb_t *gdb;
+
+  gdb = (gdb_t *)calloc (1, sizeof (gdb_t));
+  if (!gdb)
+    log (LOG_FATAL, "Malloc failed!");
+  gdb->target = target;
+
+  // Flash algorithm from CMSIS .FLM - RAM only without
+  if (args->flash) {
+    algo = (flash_algo_t *)calloc (1, sizeof (flash_algo_t));
+    if (!algo)
+      log (LOG_FATAL, "Malloc failed!");
+    rv = flash_algo_load (args->flash, algo);
+    if (rv)
+      log (LOG_FATAL, "Failed to load %s: %d", args->flash, rv);
+  }
+  gdb->algo = algo;
+
+  // Connect to core over SWD
+  target->SetPhy (PHY_SWD);
+  target->Reset (1);
+  if (target->EnableAP (true))
+    log (LOG_FATAL, "Failed to enable AP");
+  target->BridgeAPSel (0);
+  target->BridgeEn (true);
+  target->BridgeMode (MODE_SEQUENTIAL);
+  gdb->debug = new Debug (target);
+  gdb->debug->SetScratch (args->scratch);
+  gdb->debug->WatchHalt (true);
+  rv = gdb->debug->Halt (false);
+  if (rv)
+    log (LOG_FATAL, "Failed to halt: %d", rv);
+
+  // Flash algorithm runs from scratch RAM
+  if (algo) {
+    if (!args->scratch)
+      log (LOG_FATAL, "Flash programming needs --scratch");
+    gdb->flash = new Flash (target, gdb->debug);
+    rv = gdb->flash->Load (algo, args->scratch, ((algo->size + 3) & ~3) +
+                           (2 * algo->page_size) + GDB_FLASH_STACK);
+    if (rv)
+      log (LOG_FATAL, "Failed to load flash algorithm: %d", rv);
+  }
+
+  // Listen for gdb
+  srv = socket (AF_INET, SOCK_STREAM, 0);
+  if (srv < 0)
+    log (LOG_FATAL, "Failed to create socket");
+  setsockopt (srv, SOL_SOCKET, SO_REUSEADDR, &one, sizeof (one));
+  memset (&sa, 0, sizeof (sa));
+  sa.sin_family = AF_INET;
+  sa.sin_addr.s_addr = htonl (INADDR_ANY);
+  sa.sin_port = htons (args->gdb_port);
+  if (bind (srv, (struct sockaddr *)&sa, sizeof (sa)) || listen (srv, 1))
+    log (LOG_FATAL, "Failed to listen on port %d", args->gdb_port);
+  log (LOG_NORMAL, "GDB server listening on port %d", args->gdb_port);
+
+  // One session at a time
+  while ((gdb->fd = accept (srv, NULL, NULL)) >= 0) {
+    setsockopt (gdb->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof (one));
+    log (LOG_NORMAL, "GDB connected");
+    gdb->debug->Halt (false);
+    gdb_session (gdb);
+    gdb_write_done (gdb);
+    close (gdb->fd);
+    log (LOG_NORMAL, "GDB disconnected");
+  }
+
+  close (srv);
+  free (gdb->fbuf);
+  delete gdb->flash;
+  delete gdb->debug;
+  if (algo)
+    flash_algo_free (algo);
+  free (algo);
+  free (gdb);
+  return 0;
+}
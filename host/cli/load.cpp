@@ -0,0 +1,77 @@
+/**
+ * Load images listed on command line
+ *
+ * All rights reserved.
+ * Tiny Labs Inc
+ * 2022
+ */
+
+#include "flexdbg.h"
+
+#include "Target.h"
+#include "Debug.h"
+#include "log.h"
+
+#include <stdio.h>
+#include <time.h>
+
+// Show running total while image streams to target
+static void load_progress (void *arg, uint32_t bytes, uint32_t bps)
+{
+  log_nonl (LOG_NORMAL, "\r%s: %u KB (%.3f MB/s)", (const char *)arg,
+            bytes / 1024, bps / (1024.0 * 1024.0));
+}
+
+int flexdbg_load (Target *target, args_t *args)
+{
+  int i, rv;
+  uint32_t entry = 0, img_entry;
+  Debug *debug;
+  struct timespec start, end;
+  double secs;
+
+  // Connect to core over SWD
+  target->SetPhy (PHY_SWD);
+  target->Reset (1);
+  if (target->EnableAP (true))
+    log (LOG_FATAL, "Failed to enable AP");
+  target->BridgeAPSel (0);
+  target->BridgeEn (true);
+
+  // Halt core before loading
+  debug = new Debug (target);
+  debug->SetScratch (args->scratch);
+  debug->SetDelta (args->delta);
+  if (args->delta && !args->scratch)
+    log (LOG_ERR, "Delta load needs --scratch - loading all pages");
+  rv = debug->Halt (true);
+  if (rv)
+    log (LOG_FATAL, "Failed to halt: %d", rv);
+
+  // Load each image
+  for (i = 0; i < args->load_cnt; i++) {
+    debug->SetProgress (&load_progress, args->load[i].name);
+    clock_gettime (CLOCK_MONOTONIC, &start);
+    rv = debug->LoadImage (args->load[i].name, args->load[i].addr, &img_entry);
+    clock_gettime (CLOCK_MONOTONIC, &end);
+    if (rv)
+      log (LOG_FATAL, "Failed to load %s: %d", args->load[i].name, rv);
+    secs = (end.tv_sec - start.tv_sec) + ((end.tv_nsec - start.tv_nsec) / 1e9);
+    log (LOG_NORMAL, "\rLoaded %s: %u bytes in %.3fs (%.3f MB/s)",
+         args->load[i].name, debug->Loaded (), secs,
+         (debug->Loaded () / (1024.0 * 1024.0)) / secs);
+    if (img_entry)
+      entry = img_entry;
+  }
+
+  // Start last entry point found
+  if (entry) {
+    log (LOG_NORMAL, "Starting @ %08X", entry);
+    if (debug->RegWrite (REG_PC, entry | 1) ||
+        debug->RegWrite (REG_xPSR, 1 << 24) ||
+        debug->Run ())
+      log (LOG_FATAL, "Failed to start target");
+  }
+  delete debug;
+  return 0;
+}
@@ -46,6 +46,37 @@ static int parse_opts (int key, char *arg, struct argp_state *state)
       if (arg)
         args.verbose = strtoul (arg, NULL, 0);
       break;
+
+    case 's':
+      if (arg)
+        args.scratch = strtoul (arg, NULL, 0);
+      break;
+
+    case 'd':
+      args.delta = true;
+      break;
+
+    case 'g':
+      if (arg)
+        args.gdb_port = strtoul (arg, NULL, 0);
+      break;
+
+    case 'F':
+      args.flash = arg;
+      break;
+
+    case 'p':
+      args.profile = arg;
+      break;
+
+    case 't':
+      if (arg)
+        args.duration = strtod (arg, NULL);
+      break;
+
+    case 'f':
+      args.folded = arg;
+      break;
       
     case ARGP_KEY_ARG:
       args.device = arg;
@@ -68,6 +99,13 @@ static int parse_opts (int key, char *arg, struct argp_state *state)
 static struct argp_option options[] = {
                                        {0, 0, 0, 0, "Operations:", 1},
                                        {"load",    'l', "FILE", 0, "filename[@address] (default=0)\nmultiple load opts supported"},
+                                       {"scratch", 's', "ADDR", 0, "target RAM for on-target stubs"},
+                                       {"delta",   'd', 0, 0,      "only load pages that changed (needs --scratch)"},
+                                       {"gdb",     'g', "PORT", 0, "run GDB server on port"},
+                                       {"flash",   'F', "FLM", 0,  "CMSIS flash algorithm for GDB (needs --scratch)"},
+                                       {"profile", 'p', "ELF", 0,  "sample PC of running target against ELF symbols"},
+                                       {"duration", 't', "SECS", 0, "profile duration (default=10)"},
+                                       {"folded",  'f', "FILE", 0, "write leaf-only folded samples (no call stacks)"},
                                        {"verbose", 'v', "INT", 0,  "verbosity level (0-4)"},
                                        {0}
 };
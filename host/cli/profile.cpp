@@ -0,0 +1,165 @@
+/**
+ * Sample PC of running target and bin by ELF function
+ *
+ * All rights reserved.
+ * Tiny Labs Inc
+ * 2022
+ */
+
+#include "flexdbg.h"
+
+#include "Target.h"
+#include "Debug.h"
+#include "Image.h"
+#include "log.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// PCSR reads per bridge transaction
+#define PROFILE_BATCH  4096
+
+// Default sample window in seconds
+#define PROFILE_SECS   10
+
+typedef struct {
+  const char *name;
+  uint32_t addr, size;
+  uint32_t cnt;
+} prof_fn_t;
+
+typedef struct {
+  prof_fn_t *fn;
+  int cnt, max;
+} prof_t;
+
+static int add_symbol (void *arg, const char *name, uint32_t addr, uint32_t size)
+{
+  prof_t *prof = (prof_t *)arg;
+
+  if (prof->cnt == prof->max) {
+    prof->max = prof->max ? prof->max * 2 : 256;
+    prof->fn = (prof_fn_t *)realloc (prof->fn, prof->max * sizeof (prof_fn_t));
+    if (!prof->fn)
+      log (LOG_FATAL, "Malloc failed!");
+  }
+  prof->fn[prof->cnt++] = {name, addr, size, 0};
+  return 0;
+}
+
+static int by_addr (const void *a, const void *b)
+{
+  const prof_fn_t *fa = (const prof_fn_t *)a, *fb = (const prof_fn_t *)b;
+  return (fa->addr > fb->addr) - (fa->addr < fb->addr);
+}
+
+static int by_count (const void *a, const void *b)
+{
+  const prof_fn_t *fa = (const prof_fn_t *)a, *fb = (const prof_fn_t *)b;
+  return (fb->cnt > fa->cnt) - (fb->cnt < fa->cnt);
+}
+
+// Function containing pc - NULL if none
+static prof_fn_t *lookup (prof_t *prof, uint32_t pc)
+{
+  int lo = 0, hi = prof->cnt - 1, mid;
+
+  // Last function starting at or below pc
+  while (lo <= hi) {
+    mid = (lo + hi) / 2;
+    if (prof->fn[mid].addr <= pc)
+      lo = mid + 1;
+    else
+      hi = mid - 1;
+  }
+  if ((hi < 0) || (pc >= prof->fn[hi].addr + prof->fn[hi].size))
+    return NULL;
+  return &prof->fn[hi];
+}
+
+int flexdbg_profile (Target *target, args_t *args)
+{
+  int i;
+  Image img;
+  Debug *debug;
+  prof_t prof = {NULL, 0, 0};
+  prof_fn_t *fn;
+  uint32_t *pc, total = 0, idle = 0, unknown = 0;
+  struct timespec start, now;
+  double secs, limit;
+  FILE *fp;
+
+  // Function table sorted by address
+  if (img.Open (args->profile, 0) || img.Symbols (&add_symbol, &prof))
+    log (LOG_FATAL, "Failed to read symbols: %s", args->profile);
+  qsort (prof.fn, prof.cnt, sizeof (prof_fn_t), &by_addr);
+  log (LOG_DEBUG, "Profile: %d functions", prof.cnt);
+
+  pc = (uint32_t *)malloc (PROFILE_BATCH * sizeof (uint32_t));
+  if (!pc)
+    log (LOG_FATAL, "Malloc failed!");
+
+  // Attach without halting
+  target->SetPhy (PHY_SWD);
+  target->Reset (1);
+  if (target->EnableAP (true))
+    log (LOG_FATAL, "Failed to enable AP");
+  target->BridgeAPSel (0);
+  target->BridgeEn (true);
+  target->BridgeMode (MODE_NORMAL);
+  debug = new Debug (target);
+
+  // Sample for requested window
+  limit = args->duration > 0 ? args->duration : PROFILE_SECS;
+  clock_gettime (CLOCK_MONOTONIC, &start);
+  do {
+    if (debug->SamplePC (pc, PROFILE_BATCH))
+      log (LOG_FATAL, "Failed to sample PC");
+    for (i = 0; i < PROFILE_BATCH; i++) {
+      if (pc[i] == 0xFFFFFFFF)
+        idle++;
+      else if ((fn = lookup (&prof, pc[i])) != NULL)
+        fn->cnt++;
+      else
+        unknown++;
+    }
+    total += PROFILE_BATCH;
+    clock_gettime (CLOCK_MONOTONIC, &now);
+    secs = (now.tv_sec - start.tv_sec) + ((now.tv_nsec - start.tv_nsec) / 1e9);
+  } while (secs < limit);
+  log (LOG_NORMAL, "Profile: %u samples in %.3fs (%.0f samples/s)",
+       total, secs, total / secs);
+
+  // Flat profile
+  qsort (prof.fn, prof.cnt, sizeof (prof_fn_t), &by_count);
+  log (LOG_NORMAL, "  %%time  samples  function");
+  for (i = 0; (i < prof.cnt) && prof.fn[i].cnt; i++)
+    log (LOG_NORMAL, "%7.2f %8u  %s", (100.0 * prof.fn[i].cnt) / total,
+         prof.fn[i].cnt, prof.fn[i].name);
+  if (unknown)
+    log (LOG_NORMAL, "%7.2f %8u  [unknown]", (100.0 * unknown) / total, unknown);
+  if (idle)
+    log (LOG_NORMAL, "%7.2f %8u  [halted/sleep]", (100.0 * idle) / total, idle);
+
+  // Folded format but leaf only - PCSR gives no call stack, so flame
+  // graphs show one level per function
+  if (args->folded) {
+    fp = fopen (args->folded, "w");
+    if (!fp)
+      log (LOG_FATAL, "Failed to open %s", args->folded);
+    for (i = 0; (i < prof.cnt) && prof.fn[i].cnt; i++)
+      fprintf (fp, "%s %u\n", prof.fn[i].name, prof.fn[i].cnt);
+    if (unknown)
+      fprintf (fp, "[unknown] %u\n", unknown);
+    if (idle)
+      fprintf (fp, "[halted/sleep] %u\n", idle);
+    fclose (fp);
+  }
+
+  delete debug;
+  free (pc);
+  free (prof.fn);
+  return 0;
+}
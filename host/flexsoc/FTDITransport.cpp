@@ -5,6 +5,9 @@
  *  Tiny Labs Inc
  *  2019
  */
+#include <string.h>
+#include <time.h>
+
 #include "FTDITransport.h"
 #include "log.h"
 
@@ -26,6 +29,11 @@ FTDITransport::FTDITransport (void)
   rv = ftdi_set_interface (ftdi, INTERFACE_B);
   if (rv)
     log (LOG_FATAL, "Failed to set interface!");
+
+  // Init transfer ring locks
+  pthread_mutex_init (&xlock, NULL);
+  pthread_cond_init (&rx_cond, NULL);
+  pthread_cond_init (&tx_cond, NULL);
 }
 
 FTDITransport::~FTDITransport ()
@@ -34,16 +42,238 @@ FTDITransport::~FTDITransport ()
     ftdi_free (ftdi);
 }
 
+void FTDITransport::RxCallback (struct libusb_transfer *usb)
+{
+  xfer_t *x = (xfer_t *)usb->user_data;
+  FTDITransport *t = x->parent;
+  int i, sz, pkt = t->ftdi->max_packet_size;
+
+  pthread_mutex_lock (&t->xlock);
+  switch (usb->status) {
+
+    case LIBUSB_TRANSFER_COMPLETED:
+
+      // Strip two modem status bytes from each packet
+      for (i = 0, x->len = 0; i < usb->actual_length; i += pkt) {
+        sz = usb->actual_length - i;
+        sz = (sz > pkt ? pkt : sz) - 2;
+        if (sz > 0) {
+          memmove (&x->buf[x->len], &x->buf[i + 2], sz);
+          x->len += sz;
+        }
+      }
+
+      // Queue for reader or put back on the wire if empty
+      x->off = 0;
+      x->busy = false;
+      if (!t->running)
+        break;
+      else if (x->len) {
+        t->rx_ready[(t->rx_head + t->rx_cnt) % FTDI_RX_XFERS] = x - t->rx;
+        t->rx_cnt++;
+      }
+      else
+        t->Submit (x);
+      break;
+
+    case LIBUSB_TRANSFER_CANCELLED:
+      x->busy = false;
+      break;
+
+    // Device has been closed
+    default:
+      x->busy = false;
+      t->gone = true;
+      break;
+  }
+  pthread_cond_signal (&t->rx_cond);
+  pthread_mutex_unlock (&t->xlock);
+}
+
+void FTDITransport::TxCallback (struct libusb_transfer *usb)
+{
+  xfer_t *x = (xfer_t *)usb->user_data;
+  FTDITransport *t = x->parent;
+
+  pthread_mutex_lock (&t->xlock);
+  x->busy = false;
+  if (usb->status == LIBUSB_TRANSFER_NO_DEVICE)
+    t->gone = true;
+  else if ((usb->status != LIBUSB_TRANSFER_COMPLETED) &&
+           (usb->status != LIBUSB_TRANSFER_CANCELLED))
+    log (LOG_FATAL, "FTDI write failed: status=%d", usb->status);
+  else if (usb->actual_length != usb->length)
+    log (LOG_FATAL, "FTDI short write: %d/%d", usb->actual_length, usb->length);
+  pthread_cond_broadcast (&t->tx_cond);
+  pthread_mutex_unlock (&t->xlock);
+}
+
+void *FTDITransport::EventThread (void *arg)
+{
+  FTDITransport *t = (FTDITransport *)arg;
+  struct timeval tv = {0, 100000};
+  int i, busy;
+
+  // Service USB completions until stopped and all transfers retired
+  do {
+    libusb_handle_events_timeout_completed (t->ftdi->usb_ctx, &tv, NULL);
+    pthread_mutex_lock (&t->xlock);
+    for (i = 0, busy = 0; i < FTDI_RX_XFERS; i++)
+      busy += t->rx[i].busy;
+    for (i = 0; i < FTDI_TX_XFERS; i++)
+      busy += t->tx[i].busy;
+    pthread_mutex_unlock (&t->xlock);
+  } while (t->running || busy);
+  return NULL;
+}
+
+// Must be called with xlock held
+void FTDITransport::Submit (xfer_t *x)
+{
+  int rv;
+
+  libusb_fill_bulk_transfer (x->usb, ftdi->usb_dev, ftdi->in_ep, x->buf, rx_sz,
+                             &RxCallback, x, 0);
+  x->busy = true;
+  rv = libusb_submit_transfer (x->usb);
+  if (rv) {
+    x->busy = false;
+    gone = true;
+  }
+}
+
+int FTDITransport::Start (void)
+{
+  int i;
+
+  // Allocate transfers
+  for (i = 0; i < FTDI_RX_XFERS + FTDI_TX_XFERS; i++) {
+    xfer_t *x = i < FTDI_RX_XFERS ? &rx[i] : &tx[i - FTDI_RX_XFERS];
+    x->usb = libusb_alloc_transfer (0);
+    x->buf = (uint8_t *)malloc (FTDI_XFER_SZ);
+    if (!x->usb || !x->buf)
+      log (LOG_FATAL, "Failed to alloc USB transfer");
+    x->parent = this;
+    x->len = x->off = 0;
+    x->busy = false;
+  }
+  rx_head = rx_cnt = tx_idx = 0;
+  gone = false;
+  running = true;
+
+  // Queue all reads so the wire never idles
+  pthread_mutex_lock (&xlock);
+  for (i = 0; i < FTDI_RX_XFERS; i++)
+    Submit (&rx[i]);
+  pthread_mutex_unlock (&xlock);
+
+  // Spin up event thread
+  if (pthread_create (&event_tid, NULL, &EventThread, this))
+    log (LOG_FATAL, "Failed to spawn USB event thread!");
+  return gone ? -1 : 0;
+}
+
+void FTDITransport::Stop (void)
+{
+  int i;
+
+  // Cancel outstanding transfers
+  pthread_mutex_lock (&xlock);
+  running = false;
+  for (i = 0; i < FTDI_RX_XFERS; i++)
+    if (rx[i].busy)
+      libusb_cancel_transfer (rx[i].usb);
+  for (i = 0; i < FTDI_TX_XFERS; i++)
+    if (tx[i].busy)
+      libusb_cancel_transfer (tx[i].usb);
+  pthread_mutex_unlock (&xlock);
+
+  // Wait for event thread to retire them
+  pthread_join (event_tid, NULL);
+
+  // Free transfers
+  for (i = 0; i < FTDI_RX_XFERS + FTDI_TX_XFERS; i++) {
+    xfer_t *x = i < FTDI_RX_XFERS ? &rx[i] : &tx[i - FTDI_RX_XFERS];
+    libusb_free_transfer (x->usb);
+    free (x->buf);
+  }
+}
+
+// Wait for all queued writes to hit the wire
+void FTDITransport::Drain (void)
+{
+  int i;
+
+  pthread_mutex_lock (&xlock);
+  for (i = 0; i < FTDI_TX_XFERS; i++)
+    while (tx[i].busy && !gone)
+      pthread_cond_wait (&tx_cond, &xlock);
+  pthread_mutex_unlock (&xlock);
+}
+
 void FTDITransport::ReadSize (uint32_t sz)
 {
-  if (ftdi_read_data_set_chunksize (ftdi, sz))
-    log (LOG_FATAL, "Unable to set read size");
+  int pkt = ftdi->max_packet_size;
+  int wire;
+
+  // Account for modem status bytes so transfer completes with response
+  wire = ((sz + pkt - 3) / (pkt - 2)) * pkt;
+  wire = wire < pkt ? pkt : wire;
+
+  pthread_mutex_lock (&xlock);
+  rx_sz = wire > rx_max ? rx_max : wire;
+  pthread_mutex_unlock (&xlock);
 }
 
 void FTDITransport::WriteSize (uint32_t sz)
 {
-  if (ftdi_write_data_set_chunksize (ftdi, sz))
-    log (LOG_FATAL, "Unable to set write size");
+  pthread_mutex_lock (&xlock);
+  tx_sz = sz > (uint32_t)tx_max ? tx_max : (sz ? sz : 1);
+  pthread_mutex_unlock (&xlock);
+}
+
+// Transfer limit read by event thread on resubmit
+void FTDITransport::XferMax (int sz)
+{
+  pthread_mutex_lock (&xlock);
+  rx_max = tx_max = sz;
+  rx_sz = rx_sz > sz ? sz : rx_sz;
+  tx_sz = tx_sz > sz ? sz : tx_sz;
+  pthread_mutex_unlock (&xlock);
+}
+
+void FTDITransport::Calibrate (transport_probe_t probe)
+{
+  static const uint8_t latency[] = {1, 2, 4, 8, 16};
+  static const int xfer[] = {512, 4096, FTDI_XFER_SZ};
+  int i, t, best, best_lat = 1, best_xfer = FTDI_XFER_SZ;
+
+  // Latency timer - fastest single word round trip
+  for (i = 0, best = -1; i < (int)sizeof (latency); i++) {
+    if (ftdi_set_latency_timer (ftdi, latency[i]))
+      log (LOG_FATAL, "Failed to set latency timer");
+    t = probe (1) + probe (1) + probe (1) + probe (1);
+    log (LOG_DEBUG, "FTDI latency=%dms: %dus", latency[i], t / 4);
+    if ((best < 0) || (t < best)) {
+      best = t;
+      best_lat = latency[i];
+    }
+  }
+  if (ftdi_set_latency_timer (ftdi, best_lat))
+    log (LOG_FATAL, "Failed to set latency timer");
+
+  // Transfer size limit - fastest bulk read
+  for (i = 0, best = -1; i < (int)(sizeof (xfer) / sizeof (xfer[0])); i++) {
+    XferMax (xfer[i]);
+    t = probe (256);
+    log (LOG_DEBUG, "FTDI xfer=%d: %dus", xfer[i], t);
+    if ((best < 0) || (t < best)) {
+      best = t;
+      best_xfer = xfer[i];
+    }
+  }
+  XferMax (best_xfer);
+  log (LOG_DEBUG, "FTDI calibrated: latency=%dms xfer=%d", best_lat, best_xfer);
 }
 
 int FTDITransport::Open (char *id)
@@ -56,10 +286,29 @@ int FTDITransport::Open (char *id)
     // No devices found
     return -1;
 
-  // Select the interface
-  rv = ftdi_set_interface (ftdi, INTERFACE_B);
-  if (rv)
-    log (LOG_FATAL, "Failed to set interface");
+  // Read channel configuration from EEPROM
+  if (ftdi_read_eeprom (ftdi) || ftdi_eeprom_decode (ftdi, 0))
+    log (LOG_FATAL, "Unable to read FTDI EEPROM");
+
+  // Sync FIFO is only available on channel A - reopen there
+  if (ftdi_get_eeprom_value (ftdi, CHANNEL_A_TYPE, &type))
+    log (LOG_FATAL, "Unable to get ch A driver");
+  if (type == CHANNEL_IS_FIFO) {
+    ftdi_usb_close (ftdi);
+    if (ftdi_set_interface (ftdi, INTERFACE_A))
+      log (LOG_FATAL, "Failed to set interface");
+    rv = ftdi_usb_open_desc (ftdi, USB_VID, USB_PID, NULL, *id == '0' ? NULL : id);
+    if (rv < 0)
+      return -1;
+    sync_fifo = true;
+  }
+  else {
+    
+    // Select the interface
+    rv = ftdi_set_interface (ftdi, INTERFACE_B);
+    if (rv)
+      log (LOG_FATAL, "Failed to set interface");
+  }
   
   // Purge buffers
   rv = ftdi_tcioflush (ftdi);
@@ -76,69 +325,155 @@ int FTDITransport::Open (char *id)
   if (rv)
     log (LOG_FATAL, "Failed to set latency timer");
 
-  // Get interface type
-  if (ftdi_get_eeprom_value (ftdi, CHANNEL_B_TYPE, &type))
-    log (LOG_FATAL, "Unable to get ch B driver");
+  // Sync FIFO (245) - 60MHz parallel FIFO to gateware
+  if (sync_fifo) {
 
-  // If UART then set baud and send autobaud character
-  if (type == CHANNEL_IS_UART) {
-    
-    // Set baudrate to 12Mbaud (only applies to serial)
-    rv = ftdi_set_baudrate (ftdi, 12000000);
+    // Sync FIFO requires RTS/CTS flow control
+    rv = ftdi_setflowctrl (ftdi, SIO_RTS_CTS_HS);
     if (rv)
-      log (LOG_FATAL, "Failed to set baudrate");
+      log (LOG_FATAL, "Failed to set flow control");
 
-    // Set 8N2
-    rv = ftdi_set_line_property (ftdi, BITS_8, STOP_BIT_1, NONE);
+    // Switch to sync FIFO mode
+    rv = ftdi_set_bitmode (ftdi, 0xFF, BITMODE_SYNCFF);
     if (rv)
-      log (LOG_FATAL, "Failed to config UART mode: 8N2");
+      log (LOG_FATAL, "Failed to set sync FIFO mode");
+    log (LOG_DEBUG, "FTDI: sync FIFO mode");
   }
- 
-  return 0;
+  else {
+
+    // Get interface type
+    if (ftdi_get_eeprom_value (ftdi, CHANNEL_B_TYPE, &type))
+      log (LOG_FATAL, "Unable to get ch B driver");
+
+    // If UART then set baud and send autobaud character
+    if (type == CHANNEL_IS_UART) {
+      
+      // Set baudrate to 12Mbaud (only applies to serial)
+      rv = ftdi_set_baudrate (ftdi, 12000000);
+      if (rv)
+        log (LOG_FATAL, "Failed to set baudrate");
+
+      // Set 8N2
+      rv = ftdi_set_line_property (ftdi, BITS_8, STOP_BIT_1, NONE);
+      if (rv)
+        log (LOG_FATAL, "Failed to config UART mode: 8N2");
+    }
+  }
+
+  // Start streaming transfers
+  return Start ();
 }
 
 void FTDITransport::Close (void)
 {
   struct ftdi_context *id = ftdi;
   Flush ();
+  Stop ();
   ftdi = NULL;
   ftdi_usb_close (id);
 }
 
 void FTDITransport::Flush (void)
 {
+  // Let queued writes complete
+  Drain ();
+
   if (ftdi_tcioflush (ftdi))
     log (LOG_FATAL, "Failed to purge buffers");
+
+  // Drop any data already received
+  pthread_mutex_lock (&xlock);
+  while (rx_cnt) {
+    Submit (&rx[rx_ready[rx_head]]);
+    rx_head = (rx_head + 1) % FTDI_RX_XFERS;
+    rx_cnt--;
+  }
+  pthread_mutex_unlock (&xlock);
 }
 
 int FTDITransport::Read (uint8_t *buf, int len)
 {
-  int rv;
+  int sz;
+  xfer_t *x;
+  struct timespec ts;
 
-  // Do read
-  rv = ftdi_read_data (ftdi, buf, len);
+  pthread_mutex_lock (&xlock);
+
+  // Wait briefly for a completed transfer
+  if (!rx_cnt && !gone) {
+    clock_gettime (CLOCK_REALTIME, &ts);
+    ts.tv_nsec += 10000000;
+    if (ts.tv_nsec >= 1000000000) {
+      ts.tv_sec++;
+      ts.tv_nsec -= 1000000000;
+    }
+    pthread_cond_timedwait (&rx_cond, &xlock, &ts);
+  }
 
   // Device has been closed - LIBUSB_ERROR_NO_DEVICE
-  if (rv == -4)
+  if (gone) {
+    pthread_mutex_unlock (&xlock);
     return DEVICE_NOTAVAIL;
-  else if (rv < 0)
-    log (LOG_FATAL, "FTDI read failed: rv=%d", rv);
-  return rv;
+  }
+
+  // Nothing available
+  if (!rx_cnt) {
+    pthread_mutex_unlock (&xlock);
+    return 0;
+  }
+
+  // Copy from oldest transfer
+  x = &rx[rx_ready[rx_head]];
+  sz = x->len - x->off;
+  sz = sz > len ? len : sz;
+  memcpy (buf, &x->buf[x->off], sz);
+  x->off += sz;
+
+  // Requeue transfer once consumed
+  if (x->off == x->len) {
+    rx_head = (rx_head + 1) % FTDI_RX_XFERS;
+    rx_cnt--;
+    Submit (x);
+  }
+  pthread_mutex_unlock (&xlock);
+  return sz;
 }
 
 int FTDITransport::Write (const uint8_t *buf, int len)
 {
-  int rv;
-  
-  // Do write
-  rv = ftdi_write_data (ftdi, buf, len);
+  int rv, sz, written = 0;
+  xfer_t *x;
 
-  // Device has been closed - LIBUSB_ERROR_NO_DEVICE
-  if (rv == -4)
-    return DEVICE_NOTAVAIL;
-  else if (rv < 0)
-    log (LOG_FATAL, "FTDI write failed: rv=%d", rv);
+  while (written < len) {
 
-  return rv;
-}
+    pthread_mutex_lock (&xlock);
+
+    // Wait for next slot in ring to retire
+    x = &tx[tx_idx];
+    while (x->busy && !gone)
+      pthread_cond_wait (&tx_cond, &xlock);
+
+    // Device has been closed - LIBUSB_ERROR_NO_DEVICE
+    if (gone) {
+      pthread_mutex_unlock (&xlock);
+      return DEVICE_NOTAVAIL;
+    }
 
+    // Copy and queue - caller buffer is free on return
+    sz = len - written;
+    sz = sz > tx_sz ? tx_sz : sz;
+    memcpy (x->buf, &buf[written], sz);
+    libusb_fill_bulk_transfer (x->usb, ftdi->usb_dev, ftdi->out_ep, x->buf, sz,
+                               &TxCallback, x, ftdi->usb_write_timeout);
+    x->busy = true;
+    rv = libusb_submit_transfer (x->usb);
+    if (rv)
+      log (LOG_FATAL, "FTDI write failed: rv=%d", rv);
+    tx_idx = (tx_idx + 1) % FTDI_TX_XFERS;
+
+    pthread_mutex_unlock (&xlock);
+    written += sz;
+  }
+
+  return written;
+}
@@ -9,13 +9,57 @@
 #define FTDITRANSPORT_H
 
 #include <ftdi.h>
+#include <pthread.h>
 
 #include "Transport.h"
 
+// Number of USB transfers kept in flight in each direction
+#define FTDI_RX_XFERS   8
+#define FTDI_TX_XFERS   8
+
+// Max size of each USB transfer - multiple of max packet size
+#define FTDI_XFER_SZ    (16 * 1024)
+
 class FTDITransport : public Transport {
  private:
   struct ftdi_context *ftdi = NULL;
-  
+  bool sync_fifo = false;
+
+  // Queued USB transfer
+  typedef struct {
+    struct libusb_transfer *usb;
+    FTDITransport *parent;
+    uint8_t *buf;
+    int len, off;
+    bool busy;
+  } xfer_t;
+
+  // Transfer rings
+  xfer_t rx[FTDI_RX_XFERS], tx[FTDI_TX_XFERS];
+  int rx_ready[FTDI_RX_XFERS];
+  int rx_head = 0, rx_cnt = 0, tx_idx = 0;
+
+  // Transfer sizes - per operation and calibrated limit
+  int rx_sz = FTDI_XFER_SZ, tx_sz = FTDI_XFER_SZ;
+  int rx_max = FTDI_XFER_SZ, tx_max = FTDI_XFER_SZ;
+  pthread_mutex_t xlock;
+  pthread_cond_t rx_cond, tx_cond;
+
+  // libusb event thread
+  pthread_t event_tid;
+  bool running = false;
+  bool gone = false;
+
+  // Async engine
+  int Start (void);
+  void Stop (void);
+  void Submit (xfer_t *x);
+  void Drain (void);
+  void XferMax (int sz);
+  static void RxCallback (struct libusb_transfer *usb);
+  static void TxCallback (struct libusb_transfer *usb);
+  static void *EventThread (void *arg);
+
  public:
   FTDITransport (void);
   ~FTDITransport ();
@@ -30,7 +74,7 @@ class FTDITransport : public Transport {
   // Manage buffer sizes
   void ReadSize (uint32_t sz);
   void WriteSize (uint32_t sz);
+  void Calibrate (transport_probe_t probe);
 };
 
 #endif /* FTDITRANSPORT_H */
-
@@ -8,12 +8,15 @@
 #include "TCPTransport.h"
 
 #include <arpa/inet.h>
+#include <netinet/tcp.h>
 #include <sys/fcntl.h>
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <unistd.h>
 
+#include "log.h"
+
 #define DEFAULT_PORT  7878
 
 TCPTransport::TCPTransport (void)
@@ -97,6 +100,10 @@ int TCPTransport::Open (char *id)
       return -1;
   }
 
+  // Send small commands immediately
+  flags = 1;
+  setsockopt (sockfd, IPPROTO_TCP, TCP_NODELAY, &flags, sizeof (flags));
+
   // Set as non-blocking
   flags = fcntl (sockfd, F_GETFL, 0);
   fcntl (sockfd, F_SETFL, flags | O_NONBLOCK);
@@ -108,6 +115,27 @@ int TCPTransport::Open (char *id)
   return 0;
 }
 
+void TCPTransport::Calibrate (transport_probe_t probe)
+{
+  static const int bufsz[] = {16 * 1024, 64 * 1024, 256 * 1024};
+  int i, t, best = -1, best_sz = bufsz[0];
+
+  // Socket buffer size - fastest bulk read
+  for (i = 0; i < (int)(sizeof (bufsz) / sizeof (bufsz[0])); i++) {
+    setsockopt (sockfd, SOL_SOCKET, SO_SNDBUF, &bufsz[i], sizeof (bufsz[i]));
+    setsockopt (sockfd, SOL_SOCKET, SO_RCVBUF, &bufsz[i], sizeof (bufsz[i]));
+    t = probe (256);
+    log (LOG_DEBUG, "TCP buf=%d: %dus", bufsz[i], t);
+    if ((best < 0) || (t < best)) {
+      best = t;
+      best_sz = bufsz[i];
+    }
+  }
+  setsockopt (sockfd, SOL_SOCKET, SO_SNDBUF, &best_sz, sizeof (best_sz));
+  setsockopt (sockfd, SOL_SOCKET, SO_RCVBUF, &best_sz, sizeof (best_sz));
+  log (LOG_DEBUG, "TCP calibrated: buf=%d", best_sz);
+}
+
 void TCPTransport::Close (void)
 {
   // Shutdown socket
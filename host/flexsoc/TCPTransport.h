@@ -29,6 +29,9 @@ class TCPTransport : public Transport {
   int Read (uint8_t *buf, int len);
   int Write (const uint8_t *buf, int len);
   void Flush (void);
+
+  // Tune socket buffers
+  void Calibrate (transport_probe_t probe);
 };
 
 #endif /* TCPTRANSPORT_H */
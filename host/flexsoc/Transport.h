@@ -12,6 +12,9 @@
 
 #define DEVICE_NOTAVAIL  -1000
 
+// Calibration probe - returns usecs to read cnt words from gateware
+typedef int (*transport_probe_t) (int cnt);
+
 class Transport {
  protected:
   pthread_mutex_t rlock, wlock;
@@ -21,7 +24,7 @@ class Transport {
     pthread_mutex_init (&rlock, NULL);
     pthread_mutex_init (&wlock, NULL);
   }
-  ~Transport () {}
+  virtual ~Transport () {}
 
   // Interface to be met
   virtual int Open (char *id) = 0;
@@ -30,9 +33,12 @@ class Transport {
   virtual int Write (const uint8_t *buf, int len) = 0;
   virtual void Flush (void) = 0;
 
-  // Optional READ/WRITE size
-  void ReadSize (uint32_t sz) {}
-  void WriteSize (uint32_t sz) {}
+  // Optional READ/WRITE size of next operation
+  virtual void ReadSize (uint32_t sz) {}
+  virtual void WriteSize (uint32_t sz) {}
+
+  // Optional one time tuning after open
+  virtual void Calibrate (transport_probe_t probe) {}
 };
 
 #endif /* TRANSPORT_H */
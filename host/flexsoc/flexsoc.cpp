@@ -8,6 +8,7 @@
 #include <pthread.h>
 #include <unistd.h>
 #include <string.h>
+#include <time.h>
 
 #include "TCPTransport.h"
 #include "FTDITransport.h"
@@ -31,6 +32,12 @@ static int write_recv_sz;
 // Master buf size
 #define MBUF_SZ   (16 * 1024)
 
+// Max words read per calibration probe
+#define PROBE_SZ  256
+
+// Max ops per batch segment
+#define BATCH_SZ  256
+
 // Local variables
 static Transport *dev = NULL;
 static pthread_t read_tid, slave_tid;
@@ -77,6 +84,13 @@ typedef enum {
 #define CMD_READ             0x0
 #define CMD_AUTOINC          0x4
 #define CMD_WIDTH(x)         ((x) >> 1)
+#define CMD_WIDTH_EXT        0x3
+
+// Extended commands - must match host_cmd_ext.sv
+#define CMD_FILL             (CMD_INTERFACE_MASTER | CMD_PAYLOAD (FIFO_D16) | \
+                              CMD_WRITE | CMD_WIDTH_EXT)
+#define CMD_WAIT             (CMD_INTERFACE_MASTER | CMD_PAYLOAD (FIFO_D16) | \
+                              CMD_READ | CMD_WIDTH_EXT)
 
 static uint8_t payload2cmd (uint8_t len)
 {
@@ -119,6 +133,22 @@ static void dump (const char *str, const uint8_t *data, int len)
     log (LOG_TRANS, "");
 }
 
+static int flexsoc_read (uint8_t width, uint32_t addr, uint8_t *data, int len, bool autoinc);
+
+// Time fixed address reads of CSR block to calibrate transport
+static int flexsoc_probe (int cnt)
+{
+    uint32_t buf[PROBE_SZ];
+    struct timespec start, end;
+
+    cnt = cnt > PROBE_SZ ? PROBE_SZ : cnt;
+    clock_gettime (CLOCK_MONOTONIC, &start);
+    flexsoc_read (4, FLEXSOC_CSR_BASE, (uint8_t *)buf, cnt, false);
+    clock_gettime (CLOCK_MONOTONIC, &end);
+    return ((end.tv_sec - start.tv_sec) * 1000000) +
+        ((end.tv_nsec - start.tv_nsec) / 1000);
+}
+
 static void *flexsoc_slave (void *arg)
 {
     while (1) {
@@ -242,6 +272,9 @@ int flexsoc_open (char *id)
     if (rv)
         log (LOG_FATAL, "Failed to spawn flexsoc thread!");
 
+    // Tune transport buffering against live link
+    dev->Calibrate (&flexsoc_probe);
+
     // Success
     return 0;
 }
@@ -316,7 +349,7 @@ static void buf_to_host32 (uint8_t *host, const uint8_t *buf)
     *((uint32_t *)host) = ntohl (*((uint32_t *)buf));
 }
 
-static int read_process (uint8_t width, uint8_t *data, int rcnt)
+static int read_process (uint8_t width, uint8_t *data, int rcnt, int *err)
 {
     int i, read = 0;
     uint8_t rbuf[READ_RECV_BUF_SZ];
@@ -325,9 +358,11 @@ static int read_process (uint8_t width, uint8_t *data, int rcnt)
     flexsoc_recv (rbuf, rcnt);
     for (i = 0; i < (rcnt / (1 + width)); i++) {
     
-        // Verify there wasn't an error
-        if (rbuf[i * (1 + width)] & 1)
-            log (LOG_FATAL, "Read failed: %02X", rbuf[i * (1 + width)]);
+        // Record error - keep draining so stream stays in sync
+        if (rbuf[i * (1 + width)] & 1) {
+            log (LOG_DEBUG, "Read failed: %02X", rbuf[i * (1 + width)]);
+            *err = 1;
+        }
 
         // Convert back to host endian
         switch (width) {
@@ -344,7 +379,7 @@ static int read_process (uint8_t width, uint8_t *data, int rcnt)
     return read;
 }
 
-static int write_process (int rcnt)
+static int write_process (int rcnt, int *err)
 {
     int i, written = 0;
     uint8_t rbuf[WRITE_RECV_BUF_SZ];
@@ -353,9 +388,11 @@ static int write_process (int rcnt)
     flexsoc_recv (rbuf, rcnt);
     for (i = 0; i < rcnt; i++) {
     
-        // Verify there wasn't an error
-        if (rbuf[i] & 1)
-            log (LOG_FATAL, "Write failed: %02X", rbuf[i]);    
+        // Record error - keep draining so stream stays in sync
+        if (rbuf[i] & 1) {
+            log (LOG_DEBUG, "Write failed: %02X", rbuf[i]);
+            *err = 1;
+        }
     
         // Increment read
         written++;
@@ -365,9 +402,9 @@ static int write_process (int rcnt)
     return written;
 }
 
-static int flexsoc_read (uint8_t width, uint32_t addr, uint8_t *data, int len)
+static int flexsoc_read (uint8_t width, uint32_t addr, uint8_t *data, int len, bool autoinc)
 {
-    int rv, i, bi = 0, idx = 0, read = 0;
+    int rv, i, sz, bi = 0, idx = 0, read = 0, err = 0;
     bool process = false;
     int rcnt[2] = {0, 0};
   
@@ -378,15 +415,17 @@ static int flexsoc_read (uint8_t width, uint32_t addr, uint8_t *data, int len)
     // Lock API lock
     pthread_mutex_lock (&api_lock);
   
-    // Set read/write size
-    dev->WriteSize (read_send_sz);
-    dev->ReadSize (read_recv_sz);
+    // Size transport to this operation
+    sz = autoinc ? 4 + len : 5 * len;
+    dev->WriteSize (sz < read_send_sz ? sz : read_send_sz);
+    sz = len < read_send_sz ? len : read_send_sz;
+    dev->ReadSize (sz * (1 + width));
 
     // Read all data
     for (i = 0; i < len; i++) {
 
         // If we've hit buffer size then flush
-        if (idx == read_send_sz) {        
+        if (idx + (((i == 0) || !autoinc) ? 5 : 1) > read_send_sz) {
             flexsoc_send (tbuf[bi], idx);
             bi = !bi; // Switch buffers
             if (!bi) // Start processing responses
@@ -395,13 +434,13 @@ static int flexsoc_read (uint8_t width, uint32_t addr, uint8_t *data, int len)
 
             // If we've already sent two buffers then start processing
             if (process) {
-                read += read_process (width, &data[read], rcnt[bi]);
+                read += read_process (width, &data[read], rcnt[bi], &err);
                 rcnt[bi] = 0;
             }
         }
 
         // Send full read with address
-        if (i == 0) {
+        if ((i == 0) || !autoinc) {
             tbuf[bi][idx] = CMD_INTERFACE_MASTER | payload2cmd (4) |
                 CMD_READ | CMD_WIDTH (width);
             idx++;
@@ -426,20 +465,20 @@ static int flexsoc_read (uint8_t width, uint32_t addr, uint8_t *data, int len)
   
     // Process any remaining data
     if (rcnt[!bi])
-        read += read_process (width, &data[read], rcnt[!bi]);
+        read += read_process (width, &data[read], rcnt[!bi], &err);
     if (rcnt[bi])
-        read += read_process (width, &data[read], rcnt[bi]);
+        read += read_process (width, &data[read], rcnt[bi], &err);
   
     // Unlock API lock
     pthread_mutex_unlock (&api_lock);
   
-    // Return success
-    return 0;
+    // Return status
+    return err ? -1 : 0;
 }
 
 static int flexsoc_write (uint8_t width, uint32_t addr, const uint8_t *data, int len)
 {
-    int rv, i, bi = 0, idx = 0, written = 0;
+    int rv, i, sz, bi = 0, idx = 0, written = 0, err = 0;
     bool process = false;
     int rcnt[2] = {0, 0};
   
@@ -450,9 +489,11 @@ static int flexsoc_write (uint8_t width, uint32_t addr, const uint8_t *data, int
     // Lock API lock
     pthread_mutex_lock (&api_lock);
 
-    // Set read/write size
-    dev->WriteSize (write_send_sz);
-    dev->ReadSize (write_recv_sz);
+    // Size transport to this operation
+    sz = 4 + (len * (1 + width));
+    dev->WriteSize (sz < write_send_sz ? sz : write_send_sz);
+    sz = write_send_sz / (1 + width);
+    dev->ReadSize (len < sz ? len : sz);
 
     // Loop over data to write
     for (i = 0; i < len; i++) {
@@ -467,7 +508,7 @@ static int flexsoc_write (uint8_t width, uint32_t addr, const uint8_t *data, int
 
             // If we've already sent two buffers then start processing
             if (process) {
-                written += write_process (rcnt[bi]);
+                written += write_process (rcnt[bi], &err);
                 rcnt[bi] = 0;
             }
         }
@@ -508,14 +549,132 @@ static int flexsoc_write (uint8_t width, uint32_t addr, const uint8_t *data, int
     
     // Process any remaining data
     if (rcnt[!bi])
-        written += write_process (rcnt[!bi]);
+        written += write_process (rcnt[!bi], &err);
     if (rcnt[bi])
-        written += write_process (rcnt[bi]);
+        written += write_process (rcnt[bi], &err);
 
     // Unlock API lock
     pthread_mutex_unlock (&api_lock);
   
-    // Return success
+    // Return status
+    return err ? -1 : 0;
+}
+
+static int flexsoc_fill_cmd (uint8_t width, uint32_t addr, uint32_t value, uint32_t cnt)
+{
+    uint8_t buf[17];
+    uint32_t wval = width;
+    int err = 0;
+
+    // Ignore empty fills
+    if (cnt == 0)
+        return 0;
+
+    // Lock API lock
+    pthread_mutex_lock (&api_lock);
+
+    // Size transport to this operation
+    dev->WriteSize (sizeof (buf));
+    dev->ReadSize (1);
+
+    // Expanded to autoinc writes in gateware
+    buf[0] = CMD_FILL;
+    host32_to_buf (&buf[1], (uint8_t *)&addr);
+    host32_to_buf (&buf[5], (uint8_t *)&value);
+    host32_to_buf (&buf[9], (uint8_t *)&cnt);
+    host32_to_buf (&buf[13], (uint8_t *)&wval);
+    flexsoc_send (buf, sizeof (buf));
+
+    // Single status for entire fill
+    write_process (1, &err);
+
+    // Unlock API lock
+    pthread_mutex_unlock (&api_lock);
+
+    // Return status
+    return err ? -1 : 0;
+}
+
+// Check responses for one batch segment
+static void batch_process (flexsoc_op_t *op, int cnt)
+{
+    int i, idx = 0, rcnt = 0;
+    uint8_t rbuf[BATCH_SZ * 5];
+
+    // Status byte per write, status + word per read
+    for (i = 0; i < cnt; i++)
+        rcnt += op[i].write ? 1 : 5;
+    flexsoc_recv (rbuf, rcnt);
+    for (i = 0; i < cnt; i++) {
+        if (rbuf[idx] & 1)
+            log (LOG_FATAL, "%s failed: %08X", op[i].write ? "Write" : "Read",
+                 op[i].addr);
+        if (!op[i].write)
+            buf_to_host32 ((uint8_t *)&op[i].data, &rbuf[idx + 1]);
+        idx += op[i].write ? 1 : 5;
+    }
+}
+
+int flexsoc_batch (flexsoc_op_t *op, int cnt)
+{
+    int i, n, idx, prev = 0, pcnt = 0, bi = 0;
+    int sent = 0;
+    uint32_t wcnt = FLEXSOC_WAIT_CNT;
+    uint8_t sbuf[2][BATCH_SZ * 17];
+
+    if (cnt <= 0)
+        return 0;
+
+    // Lock API lock
+    pthread_mutex_lock (&api_lock);
+
+    // Size transport to first segment
+    n = cnt < BATCH_SZ ? cnt : BATCH_SZ;
+    for (i = 0, idx = 0; i < n; i++)
+        idx += op[i].write ? 9 : op[i].mask ? 17 : 5;
+    dev->WriteSize (idx);
+    dev->ReadSize (n * 5);
+
+    // Send next segment before processing previous one
+    while (sent < cnt) {
+        n = cnt - sent < BATCH_SZ ? cnt - sent : BATCH_SZ;
+        for (i = 0, idx = 0; i < n; i++) {
+            flexsoc_op_t *o = &op[sent + i];
+            log (LOG_REG, "  B%c(%08X): %08X", o->write ? 'W' : o->mask ? '?' : 'R',
+                 o->addr, (o->write || o->mask) ? o->data : 0);
+
+            // Poll in gateware until match
+            if (!o->write && o->mask) {
+                sbuf[bi][idx++] = CMD_WAIT;
+                host32_to_buf (&sbuf[bi][idx], (uint8_t *)&o->addr);
+                host32_to_buf (&sbuf[bi][idx + 4], (uint8_t *)&o->mask);
+                host32_to_buf (&sbuf[bi][idx + 8], (uint8_t *)&o->data);
+                host32_to_buf (&sbuf[bi][idx + 12], (uint8_t *)&wcnt);
+                idx += 16;
+                continue;
+            }
+            sbuf[bi][idx++] = CMD_INTERFACE_MASTER |
+                payload2cmd (o->write ? 8 : 4) |
+                (o->write ? CMD_WRITE : CMD_READ) | CMD_WIDTH (4);
+            host32_to_buf (&sbuf[bi][idx], (uint8_t *)&o->addr);
+            idx += 4;
+            if (o->write) {
+                host32_to_buf (&sbuf[bi][idx], (uint8_t *)&o->data);
+                idx += 4;
+            }
+        }
+        flexsoc_send (sbuf[bi], idx);
+        if (pcnt)
+            batch_process (&op[prev], pcnt);
+        prev = sent;
+        pcnt = n;
+        sent += n;
+        bi = !bi;
+    }
+    batch_process (&op[prev], pcnt);
+
+    // Unlock API lock
+    pthread_mutex_unlock (&api_lock);
     return 0;
 }
 
@@ -523,7 +682,16 @@ int flexsoc_readw (uint32_t addr, uint32_t *data, int len)
 {
     int rv;
     log (LOG_REG, "  RW(%08X): %u", addr, len);
-    rv = flexsoc_read (4, addr, (uint8_t *)data, len);
+    rv = flexsoc_read (4, addr, (uint8_t *)data, len, true);
+    log_dump_word (LOG_REG, 2, data, len);
+    return rv;
+}
+
+int flexsoc_readw_fixed (uint32_t addr, uint32_t *data, int len)
+{
+    int rv;
+    log (LOG_REG, "  RW=(%08X): %u", addr, len);
+    rv = flexsoc_read (4, addr, (uint8_t *)data, len, false);
     log_dump_word (LOG_REG, 2, data, len);
     return rv;
 }
@@ -532,7 +700,7 @@ int flexsoc_readh (uint32_t addr, uint16_t *data, int len)
 {
     int rv;
     log (LOG_REG, "  RH(%08X): %u", addr, len);
-    rv = flexsoc_read (2, addr, (uint8_t *)data, len);
+    rv = flexsoc_read (2, addr, (uint8_t *)data, len, true);
     log_dump_half (LOG_REG, 2, data, len);
     return rv;
 }
@@ -541,7 +709,7 @@ int flexsoc_readb (uint32_t addr, uint8_t *data, int len)
 {
     int rv;
     log (LOG_REG, "  RB(%08X): %u", addr, len);
-    rv = flexsoc_read (1, addr, (uint8_t *)data, len);
+    rv = flexsoc_read (1, addr, (uint8_t *)data, len, true);
     log_dump_byte (LOG_REG, 2, data, len);
     return rv;
 }
@@ -567,6 +735,15 @@ int flexsoc_writeb (uint32_t addr, const uint8_t *data, int len)
     return flexsoc_write (1, addr, (const uint8_t *)data, len);
 }
 
+int flexsoc_fill (uint32_t addr, uint32_t value, uint8_t width, uint32_t cnt)
+{
+    log (LOG_REG, "  F%c(%08X): %08X x %u",
+         width == 1 ? 'B' : width == 2 ? 'H' : 'W', addr, value, cnt);
+    if ((width != 1) && (width != 2) && (width != 4))
+        return -1;
+    return flexsoc_fill_cmd (width, addr, value, cnt);
+}
+
 uint32_t flexsoc_reg_read (uint32_t addr)
 {
     int rv;
@@ -11,6 +11,9 @@
 
 #include <stdint.h>
 
+// CSR block base - must be updated if HDL map changes
+#define FLEXSOC_CSR_BASE 0xF0000000
+
 // Callback for slave interface
 typedef void (*recv_cb_t) (uint8_t *buf, int len);
 
@@ -31,6 +34,24 @@ int flexsoc_writew (uint32_t addr, const uint32_t *data, int len);
 int flexsoc_writeh (uint32_t addr, const uint16_t *data, int len);
 int flexsoc_writeb (uint32_t addr, const uint8_t  *data, int len);
 
+// Read same address len times - sampling registers/FIFOs
+int flexsoc_readw_fixed (uint32_t addr, uint32_t *data, int len);
+
+// Write value cnt times from addr - width=1/2/4
+int flexsoc_fill (uint32_t addr, uint32_t value, uint8_t width, uint32_t cnt);
+
+// Batched word access - issued back to back, reads fill data
+// Reads with non-zero mask repeat in gateware until (word & mask) == data
+// or FLEXSOC_WAIT_CNT reads, data then holds the final word
+typedef struct {
+  uint32_t addr;
+  uint32_t data;
+  bool write;
+  uint32_t mask;
+} flexsoc_op_t;
+#define FLEXSOC_WAIT_CNT  1024
+int flexsoc_batch (flexsoc_op_t *op, int cnt);
+
 // Simplified register access
 uint32_t flexsoc_reg_read (uint32_t addr);
 void flexsoc_reg_write (uint32_t addr, const uint32_t data);
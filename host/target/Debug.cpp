@@ -8,10 +8,21 @@
 #include <stdint.h>
 #include <unistd.h>
 #include <stdio.h>
-#include <sys/stat.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+#include <errno.h>
 
 #include "Target.h"
 #include "Debug.h"
+#include "log.h"
+
+// Embedded target stubs - see target/
+#include "armv7m_crc32.h"
+#define CRC32_ENTRY        4
+#define CRC32_PAGES_ENTRY  8
+#define CRC32_STUB_SZ      ((sizeof (armv7m_crc32_bin) + 3) & ~3)
 
 // Register definitions
 // Debug Halting Control and Status Register
@@ -50,6 +61,9 @@
 #define MON_REQ       (1 << 19)
 #define TRACENA       (1 << 24)
 
+// DWT Program Counter Sample Register
+#define DWT_PCSR      0xE000101C
+
 // Application Interrupt and Reset Control Register
 #define AIRCR         0xE000ED0C
 #define SYSRESETREQ   (1 << 2)
@@ -63,6 +77,55 @@
 #define EVT_EXTERNAL  (1 << 4)
 #define EVT_CLRMASK   0x1F
 
+// Nibble table for CRC32 poly 0xEDB88320 - matches target stub
+static const uint32_t crc_table[16] = {
+  0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC,
+  0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+  0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+  0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+};
+
+static uint32_t crc32 (uint32_t crc, const uint8_t *data, uint32_t len)
+{
+  uint32_t i;
+  
+  crc = ~crc;
+  for (i = 0; i < len; i++) {
+    crc ^= data[i];
+    crc = crc_table[crc & 0xF] ^ (crc >> 4);
+    crc = crc_table[crc & 0xF] ^ (crc >> 4);
+  }
+  return ~crc;
+}
+
+// DHCSR re-read while the watch is on - the watch misses a halt that
+// follows a resume before it saw the core running
+#define HALT_BACKSTOP_MS  1000
+
+// Latest DHCSR pushed by gateware watch
+static pthread_mutex_t halt_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t halt_cond = PTHREAD_COND_INITIALIZER;
+static uint32_t halt_dhcsr = 0;
+static uint32_t halt_seq = 0;
+
+static void halt_notify (uint32_t dhcsr)
+{
+  log (LOG_DEBUG, "DHCSR => %08X", dhcsr);
+  pthread_mutex_lock (&halt_lock);
+  halt_dhcsr = dhcsr;
+  halt_seq++;
+  pthread_cond_broadcast (&halt_cond);
+  pthread_mutex_unlock (&halt_lock);
+}
+
+static uint64_t now_ms (void)
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ((uint64_t)ts.tv_sec * 1000) + (ts.tv_nsec / 1000000);
+}
+
 Debug::Debug (Target *t)
 {
   // Save target
@@ -71,7 +134,72 @@ Debug::Debug (Target *t)
 
 Debug::~Debug ()
 {
-  
+  if (watch)
+    WatchHalt (false);
+}
+
+int Debug::WatchHalt (bool en)
+{
+  if (en)
+    target->RegisterHaltHandler (&halt_notify);
+  target->BridgeHaltWatch (en);
+  if (!en)
+    target->UnregisterHaltHandler ();
+  watch = en;
+  halt_check = true;
+  return SUCCESS;
+}
+
+int Debug::WaitHalt (int ms)
+{
+  int i, wait;
+  uint64_t start, now;
+  struct timespec ts;
+
+  // Poll over link without gateware watch
+  if (!watch) {
+    for (i = 0; i < ms; i++) {
+      if (target->ReadReg (DHCSR) & S_HALT)
+        return SUCCESS;
+      usleep (1000);
+    }
+    return -ERR_TIMEOUT;
+  }
+
+  for (start = now = now_ms (); ; now = now_ms ()) {
+
+    // Read DHCSR once after each resume, then only as a backstop
+    if (halt_check || (now - halt_polled >= HALT_BACKSTOP_MS)) {
+      pthread_mutex_lock (&halt_lock);
+      halt_seen = halt_seq;
+      pthread_mutex_unlock (&halt_lock);
+      halted = (target->ReadReg (DHCSR) & S_HALT) != 0;
+      halt_check = false;
+      halt_polled = now;
+    }
+    if (halted)
+      return SUCCESS;
+    if (now - start >= (uint64_t)ms)
+      return -ERR_TIMEOUT;
+
+    // Sleep until gateware pushes a DHCSR change
+    wait = ms - (now - start);
+    if (HALT_BACKSTOP_MS - (now - halt_polled) < (uint64_t)wait)
+      wait = HALT_BACKSTOP_MS - (now - halt_polled);
+    clock_gettime (CLOCK_REALTIME, &ts);
+    ts.tv_sec += wait / 1000;
+    ts.tv_nsec += (wait % 1000) * 1000000;
+    ts.tv_sec += ts.tv_nsec / 1000000000;
+    ts.tv_nsec %= 1000000000;
+    pthread_mutex_lock (&halt_lock);
+    while ((halt_seq == halt_seen) &&
+           (pthread_cond_timedwait (&halt_cond, &halt_lock, &ts) != ETIMEDOUT))
+      ;
+    if (halt_seq != halt_seen)
+      halted = (halt_dhcsr & S_HALT) != 0;
+    halt_seen = halt_seq;
+    pthread_mutex_unlock (&halt_lock);
+  }
 }
 
 int Debug::Halt (bool do_reset)
@@ -115,6 +243,7 @@ int Debug::Halt (bool do_reset)
 
   // Clear DFSR events
   target->WriteReg (DFSR, EVT_CLRMASK);
+  halt_check = true;
   
   // Success
   return SUCCESS;
@@ -127,6 +256,18 @@ int Debug::Run (void)
 
   // Clear halt and unset debug enable
   target->WriteReg (DHCSR, C_KEY);
+  halt_check = true;
+  return SUCCESS;
+}
+
+int Debug::Resume (void)
+{
+  // Clear all DFSR
+  target->WriteReg (DFSR, EVT_CLRMASK);
+
+  // Clear halt but stay in debug so breakpoints halt core
+  target->WriteReg (DHCSR, C_KEY | C_DEBUGEN);
+  halt_check = true;
   return SUCCESS;
 }
 
@@ -145,6 +286,7 @@ int Debug::Step (void)
 
   // Set C_STEP and clear C_HALT
   target->WriteReg (DHCSR, C_KEY | C_STEP | C_DEBUGEN);
+  halt_check = true;
 
   // Wait for S_HALT to indicate step complete
   for (i = 0; i < timeout; i++)
@@ -157,6 +299,23 @@ int Debug::Step (void)
   return SUCCESS;
 }
 
+int Debug::SamplePC (uint32_t *pc, uint32_t cnt)
+{
+  uint32_t demcr;
+
+  if (!pc)
+    return -ERR_PARAMS;
+
+  // DWT needs trace enabled
+  demcr = target->ReadReg (DEMCR);
+  if (!(demcr & TRACENA))
+    target->WriteReg (DEMCR, demcr | TRACENA);
+
+  // Back to back reads of PCSR - core keeps running
+  target->ReadWFixed (DWT_PCSR, pc, cnt);
+  return SUCCESS;
+}
+
 int Debug::RegRead (reg_t reg, uint32_t *val)
 {
   int i;
@@ -201,45 +360,714 @@ int Debug::RegWrite (reg_t reg, uint32_t val)
   return SUCCESS;
 }
 
-int Debug::LoadBin (uint32_t addr, const char *filename)
+// Full register context - order of ReadAllRegs/WriteAllRegs
+static const reg_t all_regs[DEBUG_ALL_REGS] = {
+  REG_R0, REG_R1, REG_R2, REG_R3, REG_R4, REG_R5, REG_R6, REG_R7,
+  REG_R8, REG_R9, REG_R10, REG_R11, REG_R12, REG_SP, REG_LR, REG_PC,
+  REG_xPSR, REG_MSP, REG_PSP, REG_CTRL,
+  REG_S0, REG_S1, REG_S2, REG_S3, REG_S4, REG_S5, REG_S6, REG_S7,
+  REG_S8, REG_S9, REG_S10, REG_S11, REG_S12, REG_S13, REG_S14, REG_S15,
+  REG_S16, REG_S17, REG_S18, REG_S19, REG_S20, REG_S21, REG_S22, REG_S23,
+  REG_S24, REG_S25, REG_S26, REG_S27, REG_S28, REG_S29, REG_S30, REG_S31,
+  REG_FPSR
+};
+
+int Debug::RegReadMulti (const reg_t *reg, uint32_t *val, int cnt)
 {
-  size_t sz;
-  uint8_t *bin;
-  FILE *fbin;
-  struct stat fstat;
-  
-  // Open file
-  fbin = fopen (filename, "rb");
-  if (!fbin)
+  int i, rv;
+  flexsoc_op_t *op;
+
+  if (!reg || !val || (cnt <= 0))
     return -ERR_PARAMS;
+  op = (flexsoc_op_t *)malloc (cnt * 3 * sizeof (flexsoc_op_t));
+  if (!op)
+    return -ERR_NOMEM;
+
+  // Select register, check S_REGRDY, read data - all in one stream
+  for (i = 0; i < cnt; i++) {
+    op[i * 3] = {DCRSR, (uint32_t)reg[i], true};
+    op[(i * 3) + 1] = {DHCSR, 0, false};
+    op[(i * 3) + 2] = {DCRDR, 0, false};
+  }
+  target->Batch (op, cnt * 3);
+
+  // Transfer outran core - redo remaining registers one at a time
+  for (i = 0, rv = SUCCESS; i < cnt; i++) {
+    if (!(op[(i * 3) + 1].data & S_REGRDY))
+      break;
+    val[i] = op[(i * 3) + 2].data;
+  }
+  for (; (i < cnt) && !rv; i++)
+    rv = RegRead (reg[i], &val[i]);
+  free (op);
+  return rv;
+}
+
+int Debug::RegWriteMulti (const reg_t *reg, const uint32_t *val, int cnt)
+{
+  int i, rv;
+  flexsoc_op_t *op;
 
-  // Get file size
-  if (stat (filename, &fstat) == -1)
+  if (!reg || !val || (cnt <= 0))
     return -ERR_PARAMS;
-  sz = fstat.st_size;
+  op = (flexsoc_op_t *)malloc (cnt * 3 * sizeof (flexsoc_op_t));
+  if (!op)
+    return -ERR_NOMEM;
+
+  // Write data, select register, check S_REGRDY - all in one stream
+  for (i = 0; i < cnt; i++) {
+    op[i * 3] = {DCRDR, val[i], true};
+    op[(i * 3) + 1] = {DCRSR, (uint32_t)reg[i] | REG_WnR, true};
+    op[(i * 3) + 2] = {DHCSR, 0, false};
+  }
+  target->Batch (op, cnt * 3);
+
+  // Transfer outran core - redo remaining registers one at a time
+  for (i = 0; i < cnt; i++)
+    if (!(op[(i * 3) + 2].data & S_REGRDY))
+      break;
+  for (rv = SUCCESS; (i < cnt) && !rv; i++)
+    rv = RegWrite (reg[i], val[i]);
+  free (op);
+  return rv;
+}
+
+int Debug::ReadAllRegs (uint32_t *val, bool fpu)
+{
+  return RegReadMulti (all_regs, val, fpu ? DEBUG_ALL_REGS : DEBUG_CORE_REGS);
+}
+
+int Debug::WriteAllRegs (const uint32_t *val, bool fpu)
+{
+  return RegWriteMulti (all_regs, val, fpu ? DEBUG_ALL_REGS : DEBUG_CORE_REGS);
+}
+
+// Max steps issued per traced batch
+#define TRACE_BATCH  32
+
+int Debug::Trace (const char *filename, uint32_t cnt, const reg_t *reg, int nreg)
+{
+  int i, j, n, rv = SUCCESS, ops, batch = TRACE_BATCH;
+  uint32_t done = 0, *rec;
+  flexsoc_op_t *op, *o;
+  FILE *fp;
+
+  if (!filename || (nreg < 0) || (nreg && !reg))
+    return -ERR_PARAMS;
+
+  // Must start halted
+  if ((target->ReadReg (DHCSR) & S_HALT) == 0)
+    return -ERR_NOHALT;
+
+  // Step, check halt then read PC + extra registers
+  ops = 2 + (3 * (1 + nreg));
+  op = (flexsoc_op_t *)malloc (TRACE_BATCH * ops * sizeof (flexsoc_op_t));
+  rec = (uint32_t *)malloc ((1 + nreg) * sizeof (uint32_t));
+  fp = fopen (filename, "wb");
+  if (!op || !rec || !fp) {
+    rv = fp ? -ERR_NOMEM : -ERR_PARAMS;
+    goto cleanup;
+  }
+
+  // C_MASKINTS may only change while halted - set before first step
+  target->WriteReg (DHCSR, C_KEY | C_MASKINTS | C_HALT | C_DEBUGEN);
+
+  while (done < cnt) {
+    n = (cnt - done) < (uint32_t)batch ? cnt - done : batch;
+
+    // Gateware waits for halt/S_REGRDY so no write lands on a running core
+    for (i = 0, o = op; i < n; i++) {
+      *o++ = {DHCSR, C_KEY | C_MASKINTS | C_STEP | C_DEBUGEN, true};
+      *o++ = {DHCSR, S_HALT, false, S_HALT};
+      for (j = 0; j <= nreg; j++) {
+        *o++ = {DCRSR, (uint32_t)(j ? reg[j - 1] : REG_PC), true};
+        *o++ = {DHCSR, S_REGRDY, false, S_REGRDY};
+        *o++ = {DCRDR, 0, false};
+      }
+    }
+    target->Batch (op, n * ops);
+
+    // Write records until first step or register that wasn't ready
+    for (i = 0, o = op; i < n; i++, o += ops) {
+      if (!(o[1].data & S_HALT))
+        break;
+      for (j = 0; j <= nreg; j++) {
+        if (!(o[3 + (j * 3)].data & S_REGRDY))
+          break;
+        rec[j] = o[4 + (j * 3)].data;
+      }
+      if (j <= nreg)
+        break;
+      if (fwrite (rec, sizeof (uint32_t), 1 + nreg, fp) != (size_t)(1 + nreg)) {
+        rv = -ERR_UNKNOWN;
+        goto cleanup;
+      }
+    }
+    done += i;
+    if (i == n)
+      continue;
+
+    // Wait timed out - later steps may have run unrecorded, mark gap
+    log (LOG_ERR, "Trace: gap after %u steps", done);
+    rv = -ERR_TIMEOUT;
+    batch = batch > 1 ? batch / 2 : 1;
+    for (j = 0; j < timeout; j++)
+      if (target->ReadReg (DHCSR) & S_HALT)
+        break;
+    if (j == timeout)
+      goto cleanup;
+    memset (rec, 0, (1 + nreg) * sizeof (uint32_t));
+    rec[0] = DEBUG_TRACE_GAP;
+    if (fwrite (rec, sizeof (uint32_t), 1 + nreg, fp) != (size_t)(1 + nreg)) {
+      rv = -ERR_UNKNOWN;
+      goto cleanup;
+    }
+  }
+
+ cleanup:
+  if (fp)
+    fclose (fp);
+  free (rec);
+  free (op);
+
+  // Leave core halted with interrupts unmasked
+  target->WriteReg (DHCSR, C_KEY | C_HALT | C_DEBUGEN);
+  return rv;
+}
+
+// Min run of 0x00/0xFF words sent as fill
+#define LOAD_FILL_MIN   16
+
+// Max bytes staged per bridge write
+#define LOAD_CHUNK_SZ   (64 * 1024)
+
+// Chunks buffered between image reader and link writer
+#define LOAD_PIPE_DEPTH  4
 
-  // Round to nearest word
-  sz = (sz % 4) != 0 ? sz + 4 - (sz % 4) : sz;
+// Delta load page size and max page CRCs per stub call
+#define DELTA_PAGE_SZ    1024
+#define DELTA_MAX_PAGES  256
+
+int Debug::WriteWords (uint32_t addr, const uint32_t *words, uint32_t cnt)
+{
+  uint32_t i, j, start;
   
-  // Malloc space for file
-  bin = (uint8_t *)malloc (sz);
-  if (!bin)
+  // Long 0x00/0xFF runs use fill
+  for (i = 0, start = 0; i < cnt; i = j) {
+
+    // Find run of identical erased/zero words
+    for (j = i + 1; (j < cnt) && (words[j] == words[i]); j++)
+      ;
+    if (((words[i] != 0) && (words[i] != 0xFFFFFFFF)) ||
+        ((j - i) < LOAD_FILL_MIN))
+      continue;
+
+    // Flush data before run then fill
+    if ((i > start) &&
+        target->TryWriteW (addr + (start * 4), &words[start], i - start))
+      return -ERR_UNKNOWN;
+    if (target->TryFill (addr + (i * 4), words[i], 4, j - i))
+      return -ERR_UNKNOWN;
+    start = j;
+  }
+  if ((start < cnt) &&
+      target->TryWriteW (addr + (start * 4), &words[start], cnt - start))
+    return -ERR_UNKNOWN;
+  return SUCCESS;
+}
+
+int Debug::WriteMem (uint32_t addr, const uint8_t *data, uint32_t len)
+{
+  int rv;
+  uint32_t cnt;
+  uint32_t *buf;
+
+  // Unaligned head
+  cnt = (4 - (addr & 3)) & 3;
+  cnt = cnt > len ? len : cnt;
+  if (cnt) {
+    if (target->TryWriteB (addr, data, cnt))
+      return -ERR_UNKNOWN;
+    addr += cnt;
+    data += cnt;
+    len -= cnt;
+  }
+
+  // Write aligned source directly
+  if (((uintptr_t)data & 3) == 0) {
+    if (WriteWords (addr, (const uint32_t *)data, len / 4))
+      return -ERR_UNKNOWN;
+    addr += len & ~3;
+    data += len & ~3;
+    len &= 3;
+  }
+
+  // Stage words through aligned buffer
+  else if (len >= 4) {
+    buf = (uint32_t *)malloc (LOAD_CHUNK_SZ);
+    if (!buf)
+      return -ERR_NOMEM;
+    while (len >= 4) {
+      cnt = (len & ~3) > LOAD_CHUNK_SZ ? LOAD_CHUNK_SZ : (len & ~3);
+      memcpy (buf, data, cnt);
+      rv = WriteWords (addr, buf, cnt / 4);
+      if (rv) {
+        free (buf);
+        return rv;
+      }
+      addr += cnt;
+      data += cnt;
+      len -= cnt;
+    }
+    free (buf);
+  }
+
+  // Unaligned tail
+  if (len && target->TryWriteB (addr, data, len))
+    return -ERR_UNKNOWN;
+  return SUCCESS;
+}
+
+int Debug::ReadMem (uint32_t addr, uint8_t *data, uint32_t len)
+{
+  uint32_t cnt;
+  uint32_t *buf;
+
+  // Unaligned head
+  cnt = (4 - (addr & 3)) & 3;
+  cnt = cnt > len ? len : cnt;
+  if (cnt) {
+    if (target->TryReadB (addr, data, cnt))
+      return -ERR_UNKNOWN;
+    addr += cnt;
+    data += cnt;
+    len -= cnt;
+  }
+
+  // Read aligned destination directly
+  if (((uintptr_t)data & 3) == 0) {
+    if ((len >= 4) && target->TryReadW (addr, (uint32_t *)data, len / 4))
+      return -ERR_UNKNOWN;
+    addr += len & ~3;
+    data += len & ~3;
+    len &= 3;
+  }
+
+  // Stage words through aligned buffer
+  else if (len >= 4) {
+    buf = (uint32_t *)malloc (LOAD_CHUNK_SZ);
+    if (!buf)
+      return -ERR_NOMEM;
+    while (len >= 4) {
+      cnt = (len & ~3) > LOAD_CHUNK_SZ ? LOAD_CHUNK_SZ : (len & ~3);
+      if (target->TryReadW (addr, buf, cnt / 4)) {
+        free (buf);
+        return -ERR_UNKNOWN;
+      }
+      memcpy (data, buf, cnt);
+      addr += cnt;
+      data += cnt;
+      len -= cnt;
+    }
+    free (buf);
+  }
+
+  // Unaligned tail
+  if (len && target->TryReadB (addr, data, len))
+    return -ERR_UNKNOWN;
+  return SUCCESS;
+}
+
+int Debug::FillMem (uint32_t addr, uint8_t val, uint32_t len)
+{
+  uint32_t cnt;
+
+  // Unaligned head
+  cnt = (4 - (addr & 3)) & 3;
+  cnt = cnt > len ? len : cnt;
+  if (cnt)
+    target->Fill (addr, val, 1, cnt);
+  addr += cnt;
+  len -= cnt;
+
+  // Words then tail
+  if (len >= 4)
+    target->Fill (addr, val * 0x01010101, 4, len / 4);
+  if (len & 3)
+    target->Fill (addr + (len & ~3), val, 1, len & 3);
+  return SUCCESS;
+}
+
+int Debug::WriteDelta (uint32_t addr, const uint8_t *data, uint32_t len)
+{
+  int rv;
+  uint32_t i, pages, cnt, start, changed = 0;
+  uint32_t *crc;
+
+  if (!len)
+    return SUCCESS;
+
+  // Hash target pages in place
+  pages = (len + DELTA_PAGE_SZ - 1) / DELTA_PAGE_SZ;
+  crc = (uint32_t *)malloc (pages * sizeof (uint32_t));
+  if (!crc)
     return -ERR_NOMEM;
-  
-  // Read entire file
-  fread (bin, fstat.st_size, 1, fbin);
-  
-  // Close file
-  fclose (fbin);
+  rv = Crc32Pages (addr, len, DELTA_PAGE_SZ, crc);
+  if (rv) {
+    free (crc);
+    return rv;
+  }
+
+  // Write runs of changed pages
+  for (i = 0, start = pages; i <= pages; i++) {
+
+    // Extend run while pages differ
+    if (i < pages) {
+      cnt = len - (i * DELTA_PAGE_SZ);
+      cnt = cnt > DELTA_PAGE_SZ ? DELTA_PAGE_SZ : cnt;
+    }
+    if ((i < pages) &&
+        (crc[i] != crc32 (0, &data[i * DELTA_PAGE_SZ], cnt))) {
+      if (start == pages)
+        start = i;
+      changed++;
+      continue;
+    }
+
+    // Flush run of changed pages
+    if (start != pages) {
+      cnt = ((i * DELTA_PAGE_SZ) > len ? len : i * DELTA_PAGE_SZ) -
+        (start * DELTA_PAGE_SZ);
+      rv = WriteMem (addr + (start * DELTA_PAGE_SZ),
+                     &data[start * DELTA_PAGE_SZ], cnt);
+      if (rv)
+        break;
+      start = pages;
+    }
+  }
+  log (LOG_DEBUG, "Delta %08X: %u/%u pages changed", addr, changed, pages);
+  delta_pages += pages;
+  delta_written += changed;
+  free (crc);
+  return rv;
+}
+
+// Chunk of image queued for writing
+typedef struct {
+  uint32_t addr, len, fill;
+  uint8_t *buf;
+} load_chunk_t;
+
+// Image load pipeline - reader thread walks image into a bounded
+// ring of chunks while the caller writes them over the link
+typedef struct {
+  Image *img;
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  load_chunk_t chunk[LOAD_PIPE_DEPTH];
+  int head, cnt;
+  bool done, abort;
+  int rv;
+} load_pipe_t;
+
+// Wait for free chunk - NULL if writer aborted
+static load_chunk_t *load_next (load_pipe_t *pipe)
+{
+  load_chunk_t *chunk = NULL;
+
+  pthread_mutex_lock (&pipe->lock);
+  while ((pipe->cnt == LOAD_PIPE_DEPTH) && !pipe->abort)
+    pthread_cond_wait (&pipe->cond, &pipe->lock);
+  if (!pipe->abort)
+    chunk = &pipe->chunk[(pipe->head + pipe->cnt) % LOAD_PIPE_DEPTH];
+  pthread_mutex_unlock (&pipe->lock);
+  return chunk;
+}
+
+// Hand filled chunk to writer
+static void load_push (load_pipe_t *pipe)
+{
+  pthread_mutex_lock (&pipe->lock);
+  pipe->cnt++;
+  pthread_cond_signal (&pipe->cond);
+  pthread_mutex_unlock (&pipe->lock);
+}
+
+static int load_segment (void *arg, uint32_t addr, const uint8_t *data,
+                         uint32_t len, uint32_t fill)
+{
+  uint32_t cnt;
+  load_chunk_t *chunk;
+  load_pipe_t *pipe = (load_pipe_t *)arg;
+
+  // Copy file backed bytes - faults pages in off the link path
+  do {
+    chunk = load_next (pipe);
+    if (!chunk)
+      return -ERR_UNKNOWN;
+    cnt = len > LOAD_CHUNK_SZ ? LOAD_CHUNK_SZ : len;
+    memcpy (chunk->buf, data, cnt);
+    chunk->addr = addr;
+    chunk->len = cnt;
+    addr += cnt;
+    data += cnt;
+    len -= cnt;
+
+    // Zero fill (.bss) rides on last chunk
+    chunk->fill = len ? 0 : fill;
+    load_push (pipe);
+  } while (len);
+  return 0;
+}
+
+static void *load_reader (void *arg)
+{
+  int rv;
+  load_pipe_t *pipe = (load_pipe_t *)arg;
+
+  rv = pipe->img->Walk (&load_segment, pipe);
+  pthread_mutex_lock (&pipe->lock);
+  pipe->rv = rv;
+  pipe->done = true;
+  pthread_cond_signal (&pipe->cond);
+  pthread_mutex_unlock (&pipe->lock);
+  return NULL;
+}
+
+int Debug::LoadChunk (uint32_t addr, const uint8_t *data, uint32_t len,
+                      uint32_t fill, bool delta)
+{
+  int rv;
+
+  if (delta)
+    rv = WriteDelta (addr, data, len);
+  else
+    rv = WriteMem (addr, data, len);
+  if (!rv && fill)
+    rv = FillMem (addr + len, 0, fill);
+  return rv;
+}
+
+int Debug::LoadImage (const char *filename, uint32_t addr, uint32_t *entry,
+                      image_fmt_t fmt)
+{
+  int i, rv = 0;
+  Image img;
+  pthread_t tid;
+  load_chunk_t *chunk;
+  load_pipe_t pipe = {};
+  bool delta = this->delta && (scratch != 0);
+  struct timespec start, now;
+  double secs;
+
+  // Map file
+  if (img.Open (filename, addr, fmt))
+    return -ERR_PARAMS;
+  log (LOG_DEBUG, "Loading %s: %s", img.FormatName (), filename);
+
+  // Bounded chunk buffers
+  for (i = 0; i < LOAD_PIPE_DEPTH; i++) {
+    pipe.chunk[i].buf = (uint8_t *)malloc (LOAD_CHUNK_SZ);
+    if (!pipe.chunk[i].buf)
+      rv = -ERR_NOMEM;
+  }
+  pipe.img = &img;
+  pthread_mutex_init (&pipe.lock, NULL);
+  pthread_cond_init (&pipe.cond, NULL);
+  if (!rv && pthread_create (&tid, NULL, &load_reader, &pipe))
+    rv = -ERR_UNKNOWN;
+  if (rv) {
+    for (i = 0; i < LOAD_PIPE_DEPTH; i++)
+      free (pipe.chunk[i].buf);
+    return rv;
+  }
   
   // Enable sequential access for max throughput
   target->BridgeMode (MODE_SEQUENTIAL);
+
+  // Write chunks as reader produces them
+  loaded = 0;
+  delta_pages = delta_written = 0;
+  clock_gettime (CLOCK_MONOTONIC, &start);
+  while (1) {
+    pthread_mutex_lock (&pipe.lock);
+    while ((pipe.cnt == 0) && !pipe.done)
+      pthread_cond_wait (&pipe.cond, &pipe.lock);
+    chunk = pipe.cnt ? &pipe.chunk[pipe.head] : NULL;
+    pthread_mutex_unlock (&pipe.lock);
+    if (!chunk)
+      break;
+
+    rv = LoadChunk (chunk->addr, chunk->buf, chunk->len, chunk->fill, delta);
+    loaded += chunk->len + chunk->fill;
+
+    // Release chunk or stop reader on error
+    pthread_mutex_lock (&pipe.lock);
+    pipe.head = (pipe.head + 1) % LOAD_PIPE_DEPTH;
+    pipe.cnt--;
+    pipe.abort = (rv != 0);
+    pthread_cond_signal (&pipe.cond);
+    pthread_mutex_unlock (&pipe.lock);
+    if (rv)
+      break;
+
+    // Report progress
+    if (progress) {
+      clock_gettime (CLOCK_MONOTONIC, &now);
+      secs = (now.tv_sec - start.tv_sec) + ((now.tv_nsec - start.tv_nsec) / 1e9);
+      progress (progress_arg, loaded, secs > 0 ? (uint32_t)(loaded / secs) : 0);
+    }
+  }
+  pthread_join (tid, NULL);
+  pthread_cond_destroy (&pipe.cond);
+  pthread_mutex_destroy (&pipe.lock);
+  for (i = 0; i < LOAD_PIPE_DEPTH; i++)
+    free (pipe.chunk[i].buf);
+  if (!rv)
+    rv = pipe.rv;
+  if (rv)
+    return rv < 0 ? rv : -ERR_UNKNOWN;
+
+  // Return entry if found
+  if (entry && !img.Entry (entry))
+    *entry = 0;
+  return SUCCESS;
+}
+
+int Debug::LoadBin (uint32_t addr, const char *filename)
+{
+  return LoadImage (filename, addr, NULL, IMAGE_BIN);
+}
+
+int Debug::CallStart (uint32_t base, uint32_t entry, const uint32_t *args, int argc,
+                      uint32_t sp)
+{
+  int i;
   
-  // Write to address space
-  target->WriteW (addr, (uint32_t *)bin, sz/4);
+  // Core must be halted
+  if ((target->ReadReg (DHCSR) & S_HALT) == 0)
+    return -ERR_NOHALT;
+  if (argc > 4)
+    return -ERR_PARAMS;
 
-  // Free memory
-  free (bin);
-  return 0;
+  // Setup args and return to BKPT at base
+  for (i = 0; i < argc; i++)
+    if (RegWrite ((reg_t)(REG_R0 + i), args[i]))
+      return -ERR_TIMEOUT;
+  if (sp && RegWrite (REG_SP, sp))
+    return -ERR_TIMEOUT;
+  if (RegWrite (REG_LR, base | 1) ||
+      RegWrite (REG_PC, (base + entry) | 1) ||
+      RegWrite (REG_xPSR, 1 << 24))
+    return -ERR_TIMEOUT;
+
+  // Mask interrupts while halted then run with debug enabled
+  // so BKPT halts instead of faulting
+  target->WriteReg (DFSR, EVT_CLRMASK);
+  target->WriteReg (DHCSR, C_KEY | C_MASKINTS | C_HALT | C_DEBUGEN);
+  target->WriteReg (DHCSR, C_KEY | C_MASKINTS | C_DEBUGEN);
+  halt_check = true;
+  return SUCCESS;
+}
+
+int Debug::CallWait (uint32_t base, uint32_t *rv, int ms)
+{
+  int rc;
+  uint32_t pc;
+
+  // Wait for return
+  rc = WaitHalt (ms);
+
+  // Unmask interrupts
+  if (rc)
+    Halt (false);
+  target->WriteReg (DHCSR, C_KEY | C_HALT | C_DEBUGEN);
+  if (rc)
+    return rc;
+
+  // Make sure we halted on return trap
+  if (RegRead (REG_PC, &pc) || (pc != base))
+    return -ERR_UNKNOWN;
+
+  // Get return value
+  if (rv && RegRead (REG_R0, rv))
+    return -ERR_TIMEOUT;
+  return SUCCESS;
+}
+
+int Debug::Call (uint32_t base, uint32_t entry, const uint32_t *args, int argc,
+                 uint32_t sp, uint32_t *rv, int ms)
+{
+  int rc;
+
+  rc = CallStart (base, entry, args, argc, sp);
+  if (rc)
+    return rc;
+  return CallWait (base, rv, ms);
+}
+
+void Debug::LoadCrcStub (void)
+{
+  uint32_t stub[CRC32_STUB_SZ / 4];
+
+  memcpy (stub, armv7m_crc32_bin, sizeof (armv7m_crc32_bin));
+  target->WriteW (scratch, stub, CRC32_STUB_SZ / 4);
+}
+
+int Debug::Crc32 (uint32_t addr, uint32_t len, uint32_t *crc)
+{
+  uint32_t args[3] = {addr, len, 0};
+
+  if (!scratch || !crc)
+    return -ERR_PARAMS;
+  
+  // Load stub to scratch RAM
+  LoadCrcStub ();
+
+  // Run at core speed - allow ~100B/ms worst case
+  return Call (scratch, CRC32_ENTRY, args, 3, 0, crc, 1000 + (len / 100));
 }
 
+int Debug::Crc32Pages (uint32_t addr, uint32_t len, uint32_t page, uint32_t *crc)
+{
+  int rv;
+  uint32_t cnt, args[4];
+
+  if (!scratch || !crc || !page)
+    return -ERR_PARAMS;
+  LoadCrcStub ();
+
+  // Page CRCs written after stub in scratch
+  args[3] = scratch + CRC32_STUB_SZ;
+  while (len) {
+
+    // Limit pages per call to output buffer
+    cnt = (len + page - 1) / page;
+    cnt = cnt > DELTA_MAX_PAGES ? DELTA_MAX_PAGES : cnt;
+    args[0] = addr;
+    args[1] = (cnt * page) > len ? len : cnt * page;
+    args[2] = page;
+    rv = Call (scratch, CRC32_PAGES_ENTRY, args, 4, 0, NULL,
+               1000 + (args[1] / 100));
+    if (rv)
+      return rv;
+
+    // Read page CRCs back
+    target->ReadW (args[3], crc, cnt);
+    crc += cnt;
+    addr += args[1];
+    len -= args[1];
+  }
+  return SUCCESS;
+}
+
+int Debug::VerifyImage (uint32_t addr, const uint8_t *data, uint32_t len)
+{
+  int rv;
+  uint32_t crc;
+
+  rv = Crc32 (addr, len, &crc);
+  if (rv)
+    return rv;
+  return (crc == crc32 (0, data, len)) ? SUCCESS : -ERR_VERIFY;
+}
@@ -6,6 +6,7 @@
  *  2022
  */
 #include "Target.h"
+#include "Image.h"
 
 #ifndef DEBUG_H
 #define DEBUG_H
@@ -17,6 +18,7 @@
 #define ERR_PARAMS    3
 #define ERR_NOHALT    4
 #define ERR_NOMEM     5
+#define ERR_VERIFY    6
 
 typedef enum {
   REG_R0   = 0,
@@ -77,10 +79,36 @@ typedef enum {
   REG_S31  = 0x5F
 } reg_t;
 
+// Register context for ReadAllRegs/WriteAllRegs
+// R0-R15, xPSR, MSP, PSP, CONTROL then S0-S31, FPSCR
+#define DEBUG_CORE_REGS  20
+#define DEBUG_ALL_REGS   53
+
+// Trace record PC marking steps lost after a stall
+#define DEBUG_TRACE_GAP  0xFFFFFFFF
+
+// Load progress - bytes written so far and average rate
+typedef void (*load_progress_t) (void *arg, uint32_t bytes, uint32_t bps);
+
 class Debug {
  private:
   Target *target;
   int timeout = 20;
+  uint32_t scratch = 0;
+  uint32_t loaded = 0;
+  uint32_t delta_pages = 0, delta_written = 0;
+  bool delta = false;
+  bool watch = false;
+  bool halt_check = true, halted = false;
+  uint32_t halt_seen = 0;
+  uint64_t halt_polled = 0;
+  load_progress_t progress = NULL;
+  void *progress_arg = NULL;
+
+  int WriteWords (uint32_t addr, const uint32_t *words, uint32_t cnt);
+  int LoadChunk (uint32_t addr, const uint8_t *data, uint32_t len,
+                 uint32_t fill, bool delta);
+  void LoadCrcStub (void);
   
  public:
   Debug (Target *t);
@@ -88,18 +116,82 @@ class Debug {
 
   // Set timeout retries
   void SetTimeout (int timeout) {this->timeout = timeout;}
+
+  // Set target RAM used to run stubs
+  void SetScratch (uint32_t addr) {this->scratch = addr;}
+
+  // Only write pages that differ from target - requires scratch
+  void SetDelta (bool en) {this->delta = en;}
+
+  // Called after each chunk of an image is written
+  void SetProgress (load_progress_t cb, void *arg) {progress = cb; progress_arg = arg;}
   
   // Run control
   int Halt (bool do_reset);
   int Run (void);
+  int Resume (void);
   int Step (void);
+
+  // Gateware pushes DHCSR halt/lockup/reset changes instead of polling
+  int WatchHalt (bool en);
+
+  // Block until core halted or ms elapsed
+  int WaitHalt (int ms);
+
+  // Step cnt instructions writing {PC, reg[0..nreg-1]} per step to file
+  // A stall writes a DEBUG_TRACE_GAP record, tracing goes on to cnt steps
+  // and -ERR_TIMEOUT is returned
+  int Trace (const char *filename, uint32_t cnt, const reg_t *reg, int nreg);
   
+  // Sample running PC from DWT_PCSR - 0xFFFFFFFF if halted/sleeping
+  int SamplePC (uint32_t *pc, uint32_t cnt);
+
   // Access core registers
   int RegRead (reg_t reg, uint32_t *val);
   int RegWrite (reg_t reg, uint32_t val);
 
+  // Batched register access - one round trip for whole list
+  int RegReadMulti (const reg_t *reg, uint32_t *val, int cnt);
+  int RegWriteMulti (const reg_t *reg, const uint32_t *val, int cnt);
+  int ReadAllRegs (uint32_t *val, bool fpu);
+  int WriteAllRegs (const uint32_t *val, bool fpu);
+
   // Load binary into RAM
   int LoadBin (uint32_t addr, const char *filename);
+
+  // Load ELF/HEX/SREC/BIN image - addr only used for BIN
+  int LoadImage (const char *filename, uint32_t addr, uint32_t *entry,
+                 image_fmt_t fmt = IMAGE_AUTO);
+  uint32_t Loaded (void) { return loaded; }
+
+  // Delta pages compared and rewritten by last load
+  uint32_t DeltaPages (void) { return delta_pages; }
+  uint32_t DeltaWritten (void) { return delta_written; }
+
+  // Read memory of any alignment - bus faults return -ERR_UNKNOWN
+  int ReadMem (uint32_t addr, uint8_t *data, uint32_t len);
+
+  // Write memory of any alignment - zero/erased runs sent as fill,
+  // bus faults return -ERR_UNKNOWN
+  int WriteMem (uint32_t addr, const uint8_t *data, uint32_t len);
+  int FillMem (uint32_t addr, uint8_t val, uint32_t len);
+
+  // Write only pages whose target CRC differs from data
+  int WriteDelta (uint32_t addr, const uint8_t *data, uint32_t len);
+
+  // Call function in blob at base with BKPT at offset 0
+  int Call (uint32_t base, uint32_t entry, const uint32_t *args, int argc,
+            uint32_t sp, uint32_t *rv, int ms);
+
+  // Split call - host can use bridge while target runs
+  int CallStart (uint32_t base, uint32_t entry, const uint32_t *args, int argc,
+                 uint32_t sp);
+  int CallWait (uint32_t base, uint32_t *rv, int ms);
+
+  // CRC32 of target memory computed on target
+  int Crc32 (uint32_t addr, uint32_t len, uint32_t *crc);
+  int Crc32Pages (uint32_t addr, uint32_t len, uint32_t page, uint32_t *crc);
+  int VerifyImage (uint32_t addr, const uint8_t *data, uint32_t len);
 };
 
 #endif /* DEBUG_H */
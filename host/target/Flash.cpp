@@ -0,0 +1,340 @@
+/**
+ *  Program flash using CMSIS style algorithms loaded to target RAM
+ *
+ *  All rights reserved.
+ *  Tiny Labs Inc
+ *  2022
+ */
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Flash.h"
+#include "Image.h"
+#include "log.h"
+
+// Minimum stack left for algorithm
+#define FLASH_STACK_SZ    256
+
+// Default timeouts (ms)
+#define FLASH_ERASE_MS    1000
+#define FLASH_PROGRAM_MS  1000
+
+// Max code + data of .FLM algorithm
+#define FLM_MAX_SZ        (64 * 1024)
+
+// Return trap prepended to .FLM code - BKPT #0, NOP
+#define FLM_TRAP_SZ       4
+static const uint8_t flm_trap[FLM_TRAP_SZ] = {0x00, 0xBE, 0x00, 0xBF};
+
+// CMSIS FlashDevice descriptor (FlashOS.h)
+typedef struct __attribute__ ((packed)) {
+  uint16_t vers;
+  char name[128];
+  uint16_t type;
+  uint32_t addr;
+  uint32_t size;
+  uint32_t page_size;
+  uint32_t res;
+  uint8_t erased;
+  uint8_t pad[3];
+  uint32_t prog_ms;
+  uint32_t erase_ms;
+  struct {
+    uint32_t size;
+    uint32_t addr;
+  } sector[];
+} flm_dev_t;
+
+#define FLM_SECTOR_END    0xFFFFFFFF
+
+// Collected while walking .FLM segments
+typedef struct {
+  uint32_t dev;
+  const flm_dev_t *desc;
+  uint32_t desc_len;
+  uint8_t *blob;
+  uint32_t size;
+  uint32_t data;
+  int nseg;
+} flm_t;
+
+// Code/data copied behind trap - descriptor only parsed
+static int flm_seg (void *arg, uint32_t addr, const uint8_t *data,
+                    uint32_t len, uint32_t fill)
+{
+  flm_t *f = (flm_t *)arg;
+
+  if ((f->dev >= addr) && (f->dev < addr + len)) {
+    f->desc = (const flm_dev_t *)&data[f->dev - addr];
+    f->desc_len = len - (f->dev - addr);
+    return 0;
+  }
+  if ((uint64_t)addr + len + fill > FLM_MAX_SZ - FLM_TRAP_SZ)
+    return -ERR_NOMEM;
+  memcpy (&f->blob[FLM_TRAP_SZ + addr], data, len);
+  if (FLM_TRAP_SZ + addr + len + fill > f->size)
+    f->size = FLM_TRAP_SZ + addr + len + fill;
+
+  // RW data follows code - R9 points at it
+  if (f->nseg++ && (FLM_TRAP_SZ + addr > f->data))
+    f->data = FLM_TRAP_SZ + addr;
+  return 0;
+}
+
+int flash_algo_load (const char *filename, flash_algo_t *algo)
+{
+  int i, rv;
+  Image img;
+  flm_t f;
+  uint32_t cnt;
+  const char *entry[4] = {"Init", "UnInit", "EraseSector", "ProgramPage"};
+  uint32_t *off[4] = {&algo->init, &algo->uninit, &algo->erase_sector,
+                      &algo->program_page};
+
+  memset (algo, 0, sizeof (*algo));
+  memset (&f, 0, sizeof (f));
+  if (img.Open (filename, 0, IMAGE_ELF))
+    return -ERR_PARAMS;
+
+  // Entry points are offset by trap
+  for (i = 0; i < 4; i++) {
+    if (img.Symbol (entry[i], off[i], NULL)) {
+      log (LOG_ERR, "%s: missing %s", filename, entry[i]);
+      return -ERR_PARAMS;
+    }
+    *off[i] += FLM_TRAP_SZ;
+  }
+  if (img.Symbol ("FlashDevice", &f.dev, NULL)) {
+    log (LOG_ERR, "%s: missing FlashDevice", filename);
+    return -ERR_PARAMS;
+  }
+
+  // Gather code and data
+  f.blob = (uint8_t *)calloc (1, FLM_MAX_SZ);
+  if (!f.blob)
+    return -ERR_NOMEM;
+  memcpy (f.blob, flm_trap, FLM_TRAP_SZ);
+  f.size = FLM_TRAP_SZ;
+  rv = img.Walk (flm_seg, &f);
+  if (!rv && (!f.desc || (f.desc_len < sizeof (flm_dev_t) + 8)))
+    rv = -ERR_PARAMS;
+  if (rv) {
+    free (f.blob);
+    return rv;
+  }
+
+  // Sector list terminated by end marker - must be uniform
+  cnt = (f.desc_len - sizeof (flm_dev_t)) / 8;
+  for (i = 1; (i < (int)cnt) && (f.desc->sector[i].size != FLM_SECTOR_END); i++) {
+    if (f.desc->sector[i].size != f.desc->sector[0].size) {
+      log (LOG_ERR, "%s: non-uniform sectors not supported", filename);
+      free (f.blob);
+      return -ERR_PARAMS;
+    }
+  }
+
+  algo->blob = f.blob;
+  algo->size = f.size;
+  algo->static_base = f.data ? f.data : f.size;
+  algo->flash_start = f.desc->addr;
+  algo->flash_size = f.desc->size;
+  algo->page_size = f.desc->page_size;
+  algo->sector_size = f.desc->sector[0].size;
+  algo->erased = f.desc->erased;
+  algo->erase_ms = f.desc->erase_ms;
+  algo->program_ms = f.desc->prog_ms;
+  log (LOG_DEBUG, "FLM %.128s: %08X+%X page=%u sector=%u size=%u",
+       f.desc->name, algo->flash_start, algo->flash_size, algo->page_size,
+       algo->sector_size, algo->size);
+  return SUCCESS;
+}
+
+void flash_algo_free (flash_algo_t *algo)
+{
+  free ((void *)algo->blob);
+  algo->blob = NULL;
+}
+
+Flash::Flash (Target *t, Debug *d)
+{
+  this->target = t;
+  this->debug = d;
+}
+
+Flash::~Flash ()
+{
+  free (page);
+}
+
+int Flash::Load (const flash_algo_t *algo, uint32_t addr, uint32_t sz)
+{
+  uint32_t words;
+  uint32_t *blob;
+
+  // Validate algorithm
+  if (!algo || !algo->blob || !algo->page_size || !algo->sector_size ||
+      (algo->page_size % 4) || (addr % 4))
+    return -ERR_PARAMS;
+
+  // Layout: blob | page buffer 0 | page buffer 1 | stack
+  words = (algo->size + 3) / 4;
+  buf[0] = addr + (words * 4);
+  buf[1] = buf[0] + algo->page_size;
+  sp = (addr + sz) & ~7;
+  if (buf[1] + algo->page_size + FLASH_STACK_SZ > sp)
+    return -ERR_NOMEM;
+
+  // Page staging buffer
+  free (page);
+  page = (uint32_t *)malloc (algo->page_size);
+  if (!page)
+    return -ERR_NOMEM;
+  
+  // Copy blob to target
+  blob = (uint32_t *)calloc (words, 4);
+  if (!blob)
+    return -ERR_NOMEM;
+  memcpy (blob, algo->blob, algo->size);
+  target->WriteW (addr, blob, words);
+  free (blob);
+
+  // Save algorithm
+  this->algo = algo;
+  this->ram = addr;
+  log (LOG_DEBUG, "Flash algo @ %08X buf=%08X/%08X sp=%08X",
+       addr, buf[0], buf[1], sp);
+  return SUCCESS;
+}
+
+int Flash::Init (uint32_t fnc)
+{
+  int rc;
+  uint32_t rv, args[3] = {algo->flash_start, 0, fnc};
+
+  // Static base for position independent data
+  rc = debug->RegWrite (REG_R9, ram + algo->static_base);
+  if (rc)
+    return rc;
+  rc = debug->Call (ram, algo->init, args, 3, sp, &rv, FLASH_ERASE_MS);
+  if (rc)
+    return rc;
+  return rv ? -ERR_UNKNOWN : SUCCESS;
+}
+
+int Flash::UnInit (uint32_t fnc)
+{
+  int rc;
+  uint32_t rv;
+
+  rc = debug->Call (ram, algo->uninit, &fnc, 1, sp, &rv, FLASH_ERASE_MS);
+  if (rc)
+    return rc;
+  return rv ? -ERR_UNKNOWN : SUCCESS;
+}
+
+int Flash::EraseSectors (uint32_t addr, uint32_t len)
+{
+  int rc;
+  uint32_t sector, rv;
+  int ms = algo->erase_ms ? algo->erase_ms : FLASH_ERASE_MS;
+
+  // Erase every sector touched by range
+  for (sector = addr - ((addr - algo->flash_start) % algo->sector_size);
+       sector < addr + len; sector += algo->sector_size) {
+    rc = debug->Call (ram, algo->erase_sector, &sector, 1, sp, &rv, ms);
+    if (rc)
+      return rc;
+    if (rv) {
+      log (LOG_ERR, "Erase failed @ %08X: %u", sector, rv);
+      return -ERR_UNKNOWN;
+    }
+  }
+  return SUCCESS;
+}
+
+int Flash::Erase (uint32_t addr, uint32_t len)
+{
+  int rc;
+
+  if (!algo)
+    return -ERR_PARAMS;
+  if ((addr < algo->flash_start) ||
+      (addr + len > algo->flash_start + algo->flash_size))
+    return -ERR_PARAMS;
+
+  rc = Init (FLASH_FNC_ERASE);
+  if (rc)
+    return rc;
+  rc = EraseSectors (addr, len);
+  UnInit (FLASH_FNC_ERASE);
+  return rc;
+}
+
+void Flash::WritePage (int idx, const uint8_t *data, uint32_t len)
+{
+  // Pad partial page with erased value
+  memset (page, algo->erased, algo->page_size);
+  memcpy (page, data, len);
+  target->WriteW (buf[idx], page, algo->page_size / 4);
+}
+
+int Flash::Program (uint32_t addr, const uint8_t *data, uint32_t len,
+                    bool erase)
+{
+  int rc, bi = 0;
+  bool busy = false;
+  uint32_t off, cnt, rv = 0, args[3];
+  int ms;
+  
+  if (!algo)
+    return -ERR_PARAMS;
+  if ((addr < algo->flash_start) ||
+      (addr + len > algo->flash_start + algo->flash_size) ||
+      ((addr - algo->flash_start) % algo->page_size))
+    return -ERR_PARAMS;
+  ms = algo->program_ms ? algo->program_ms : FLASH_PROGRAM_MS;
+
+  // Erase first
+  rc = erase ? Erase (addr, len) : SUCCESS;
+  if (rc)
+    return rc;
+
+  rc = Init (FLASH_FNC_PROGRAM);
+  if (rc)
+    return rc;
+  for (off = 0; off < len; off += algo->page_size) {
+
+    // Stream page into free buffer while target programs other
+    cnt = (len - off) < algo->page_size ? len - off : algo->page_size;
+    WritePage (bi, &data[off], cnt);
+
+    // Wait for previous page
+    if (busy) {
+      rc = debug->CallWait (ram, &rv, ms);
+      busy = false;
+      if (rc || rv)
+        break;
+    }
+
+    // Program this page
+    args[0] = addr + off;
+    args[1] = algo->page_size;
+    args[2] = buf[bi];
+    rc = debug->CallStart (ram, algo->program_page, args, 3, sp);
+    if (rc)
+      break;
+    busy = true;
+    bi = !bi;
+  }
+
+  // Wait for last page
+  if (busy)
+    rc = debug->CallWait (ram, &rv, ms);
+  if (!rc && rv) {
+    log (LOG_ERR, "Program failed: %u", rv);
+    rc = -ERR_UNKNOWN;
+  }
+  UnInit (FLASH_FNC_PROGRAM);
+  return rc;
+}
@@ -0,0 +1,81 @@
+/**
+ *  Program flash using CMSIS style algorithms loaded to target RAM.
+ *  Next page is streamed over the bridge into a second RAM buffer
+ *  while the target programs the current one.
+ *
+ *  All rights reserved.
+ *  Tiny Labs Inc
+ *  2022
+ */
+#include "Target.h"
+#include "Debug.h"
+
+#ifndef FLASH_H
+#define FLASH_H
+
+// CMSIS Init/UnInit function codes
+#define FLASH_FNC_ERASE    1
+#define FLASH_FNC_PROGRAM  2
+#define FLASH_FNC_VERIFY   3
+
+// Flash algorithm - position independent blob with BKPT at offset 0
+typedef struct flash_algo {
+  const uint8_t *blob;
+  uint32_t size;
+
+  // Entry point offsets into blob
+  uint32_t init;          // Init (adr, clk, fnc)
+  uint32_t uninit;        // UnInit (fnc)
+  uint32_t erase_sector;  // EraseSector (adr)
+  uint32_t program_page;  // ProgramPage (adr, sz, buf)
+  uint32_t static_base;   // Offset of RW data passed in R9
+
+  // Device geometry
+  uint32_t flash_start;
+  uint32_t flash_size;
+  uint32_t page_size;
+  uint32_t sector_size;
+  uint8_t erased;
+
+  // Timeouts in ms - 0 for default
+  int erase_ms;
+  int program_ms;
+} flash_algo_t;
+
+// Build algorithm from CMSIS .FLM (ELF with FlashDevice descriptor).
+// Blob is allocated with BKPT trap prepended - release with flash_algo_free.
+// Only uniform sector sizes supported.
+int flash_algo_load (const char *filename, flash_algo_t *algo);
+void flash_algo_free (flash_algo_t *algo);
+
+class Flash {
+ private:
+  Target *target;
+  Debug *debug;
+  const flash_algo_t *algo = NULL;
+  uint32_t ram = 0, sp = 0;
+  uint32_t buf[2];
+  uint32_t *page = NULL;
+
+  int Init (uint32_t fnc);
+  int UnInit (uint32_t fnc);
+  int EraseSectors (uint32_t addr, uint32_t len);
+  void WritePage (int idx, const uint8_t *data, uint32_t len);
+  
+ public:
+  Flash (Target *t, Debug *d);
+  virtual ~Flash ();
+
+  // Load algorithm into target RAM [addr, addr + sz)
+  int Load (const flash_algo_t *algo, uint32_t addr, uint32_t sz);
+
+  // Erase all sectors covering range
+  int Erase (uint32_t addr, uint32_t len);
+
+  // Erase and program range - addr must be page aligned. Skip the erase
+  // when the caller already erased the covering sectors.
+  int Program (uint32_t addr, const uint8_t *data, uint32_t len,
+               bool erase = true);
+};
+
+#endif /* FLASH_H */
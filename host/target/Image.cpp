@@ -0,0 +1,389 @@
+/**
+ *  Memory mapped image parser
+ *
+ *  All rights reserved.
+ *  Tiny Labs Inc
+ *  2022
+ */
+#include <elf.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "Image.h"
+#include "log.h"
+
+// Max contiguous bytes staged from record based formats
+#define IMAGE_REC_SZ  (64 * 1024)
+
+Image::~Image ()
+{
+  Close ();
+}
+
+int Image::Open (const char *filename, uint32_t base, image_fmt_t fmt)
+{
+  struct stat st;
+
+  // Map entire file read only
+  fd = open (filename, O_RDONLY);
+  if (fd < 0)
+    return -1;
+  if ((fstat (fd, &st) < 0) || (st.st_size == 0)) {
+    Close ();
+    return -1;
+  }
+  sz = st.st_size;
+  map = (const uint8_t *)mmap (NULL, sz, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (map == MAP_FAILED) {
+    map = NULL;
+    Close ();
+    return -1;
+  }
+  madvise ((void *)map, sz, MADV_SEQUENTIAL);
+
+  // Detect format
+  if (fmt == IMAGE_AUTO) {
+    if ((sz >= SELFMAG) && !memcmp (map, ELFMAG, SELFMAG))
+      fmt = IMAGE_ELF;
+    else if (map[0] == ':')
+      fmt = IMAGE_HEX;
+    else if ((map[0] == 'S') && (sz > 1) && (map[1] >= '0') && (map[1] <= '9'))
+      fmt = IMAGE_SREC;
+    else
+      fmt = IMAGE_BIN;
+  }
+  this->fmt = fmt;
+  this->base = base;
+  has_entry = false;
+  return 0;
+}
+
+void Image::Close (void)
+{
+  if (map)
+    munmap ((void *)map, sz);
+  if (fd >= 0)
+    close (fd);
+  free (rec);
+  map = NULL;
+  rec = NULL;
+  fd = -1;
+  sz = 0;
+}
+
+const char *Image::FormatName (void)
+{
+  switch (fmt) {
+    case IMAGE_BIN:  return "BIN";
+    case IMAGE_ELF:  return "ELF";
+    case IMAGE_HEX:  return "HEX";
+    case IMAGE_SREC: return "SREC";
+    default:         return "UNKNOWN";
+  }
+}
+
+bool Image::Entry (uint32_t *entry)
+{
+  if (has_entry && entry)
+    *entry = this->entry;
+  return has_entry;
+}
+
+int Image::Walk (image_seg_t cb, void *arg)
+{
+  if (!map)
+    return -1;
+  switch (fmt) {
+    case IMAGE_ELF:  return WalkElf (cb, arg);
+    case IMAGE_HEX:  return WalkHex (cb, arg);
+    case IMAGE_SREC: return WalkSrec (cb, arg);
+    default:         return cb (arg, base, map, sz, 0);
+  }
+}
+
+int Image::WalkElf (image_seg_t cb, void *arg)
+{
+  int i, rv;
+  const Elf32_Ehdr *ehdr = (const Elf32_Ehdr *)map;
+  const Elf32_Phdr *phdr;
+
+  // Only 32bit little endian ARM supported
+  if ((sz < sizeof (Elf32_Ehdr)) ||
+      (ehdr->e_ident[EI_CLASS] != ELFCLASS32) ||
+      (ehdr->e_ident[EI_DATA] != ELFDATA2LSB) ||
+      (ehdr->e_machine != EM_ARM)) {
+    log (LOG_ERR, "Unsupported ELF");
+    return -1;
+  }
+  if ((ehdr->e_phoff + (ehdr->e_phnum * sizeof (Elf32_Phdr))) > sz)
+    return -1;
+
+  // Save entry point
+  entry = ehdr->e_entry;
+  has_entry = true;
+  
+  // Walk loadable segments at physical address
+  phdr = (const Elf32_Phdr *)&map[ehdr->e_phoff];
+  for (i = 0; i < ehdr->e_phnum; i++) {
+    if ((phdr[i].p_type != PT_LOAD) || (phdr[i].p_memsz == 0))
+      continue;
+    if ((phdr[i].p_offset + phdr[i].p_filesz > sz) ||
+        (phdr[i].p_filesz > phdr[i].p_memsz))
+      return -1;
+    log (LOG_DEBUG, "LOAD %08X file=%u mem=%u", phdr[i].p_paddr,
+         phdr[i].p_filesz, phdr[i].p_memsz);
+    rv = cb (arg, phdr[i].p_paddr, &map[phdr[i].p_offset], phdr[i].p_filesz,
+             phdr[i].p_memsz - phdr[i].p_filesz);
+    if (rv)
+      return rv;
+  }
+  return 0;
+}
+
+int Image::Symbols (image_sym_t cb, void *arg, bool all)
+{
+  int i, rv;
+  bool func;
+  uint32_t j, cnt;
+  const Elf32_Ehdr *ehdr = (const Elf32_Ehdr *)map;
+  const Elf32_Shdr *shdr, *strtab;
+  const Elf32_Sym *sym;
+  const char *str;
+
+  if (!map || (fmt != IMAGE_ELF) || (sz < sizeof (Elf32_Ehdr)))
+    return -1;
+  if ((ehdr->e_shoff + (ehdr->e_shnum * sizeof (Elf32_Shdr))) > sz)
+    return -1;
+
+  // Find symbol tables and their string tables
+  shdr = (const Elf32_Shdr *)&map[ehdr->e_shoff];
+  for (i = 0; i < ehdr->e_shnum; i++) {
+    if ((shdr[i].sh_type != SHT_SYMTAB) || (shdr[i].sh_link >= ehdr->e_shnum))
+      continue;
+    strtab = &shdr[shdr[i].sh_link];
+    if ((shdr[i].sh_offset + shdr[i].sh_size > sz) ||
+        (strtab->sh_offset + strtab->sh_size > sz))
+      return -1;
+    sym = (const Elf32_Sym *)&map[shdr[i].sh_offset];
+    str = (const char *)&map[strtab->sh_offset];
+    cnt = shdr[i].sh_size / sizeof (Elf32_Sym);
+
+    // Report sized functions unless all defined symbols asked for
+    for (j = 0; j < cnt; j++) {
+      func = ELF32_ST_TYPE (sym[j].st_info) == STT_FUNC;
+      if ((sym[j].st_name >= strtab->sh_size) ||
+          (sym[j].st_shndx == SHN_UNDEF) ||
+          (!all && (!func || (sym[j].st_size == 0))))
+        continue;
+
+      // Thumb bit only set on functions
+      rv = cb (arg, &str[sym[j].st_name],
+               func ? sym[j].st_value & ~1 : sym[j].st_value, sym[j].st_size);
+      if (rv)
+        return rv;
+    }
+  }
+  return 0;
+}
+
+// Symbol lookup state
+typedef struct {
+  const char *name;
+  uint32_t *addr;
+  uint32_t *size;
+} sym_find_t;
+
+static int sym_find (void *arg, const char *name, uint32_t addr, uint32_t size)
+{
+  sym_find_t *find = (sym_find_t *)arg;
+
+  if (strcmp (name, find->name))
+    return 0;
+  *find->addr = addr;
+  if (find->size)
+    *find->size = size;
+  return 1;
+}
+
+int Image::Symbol (const char *name, uint32_t *addr, uint32_t *size)
+{
+  sym_find_t find = {name, addr, size};
+
+  return (Symbols (&sym_find, &find, true) == 1) ? 0 : -1;
+}
+
+int Image::Flush (image_seg_t cb, void *arg)
+{
+  int rv = 0;
+  if (rec_len)
+    rv = cb (arg, rec_addr, rec, rec_len, 0);
+  rec_len = 0;
+  return rv;
+}
+
+int Image::Append (image_seg_t cb, void *arg, uint32_t addr, const uint8_t *data, uint32_t len)
+{
+  int rv;
+  
+  // Start new segment if not contiguous or full
+  if ((addr != rec_addr + rec_len) || (rec_len + len > IMAGE_REC_SZ)) {
+    rv = Flush (cb, arg);
+    if (rv)
+      return rv;
+    rec_addr = addr;
+  }
+  memcpy (&rec[rec_len], data, len);
+  rec_len += len;
+  return 0;
+}
+
+static int hex2bin (const uint8_t *hex, uint8_t *bin, int cnt)
+{
+  int i, hi, lo;
+  
+  for (i = 0; i < cnt; i++) {
+    hi = hex[i * 2];
+    lo = hex[(i * 2) + 1];
+    hi = (hi <= '9') ? hi - '0' : (hi | 0x20) - 'a' + 10;
+    lo = (lo <= '9') ? lo - '0' : (lo | 0x20) - 'a' + 10;
+    if ((hi < 0) || (hi > 15) || (lo < 0) || (lo > 15))
+      return -1;
+    bin[i] = (hi << 4) | lo;
+  }
+  return 0;
+}
+
+// Find next record start char - returns offset or sz
+static size_t next_rec (const uint8_t *map, size_t sz, size_t off, uint8_t start)
+{
+  while ((off < sz) && (map[off] != start))
+    off++;
+  return off;
+}
+
+int Image::WalkHex (image_seg_t cb, void *arg)
+{
+  int rv;
+  size_t off = 0;
+  uint8_t buf[260], sum, len, type;
+  uint32_t i, ext = 0;
+
+  rec = (uint8_t *)malloc (IMAGE_REC_SZ);
+  if (!rec)
+    return -1;
+  rec_len = 0;
+
+  // :LLAAAATT[DD...]CC
+  while ((off = next_rec (map, sz, off, ':')) < sz) {
+    off++;
+    if ((off + 10 > sz) || hex2bin (&map[off], buf, 1))
+      return -1;
+    len = buf[0];
+    if ((off + ((len + 5) * 2) > sz) || hex2bin (&map[off], buf, len + 5))
+      return -1;
+    off += (len + 5) * 2;
+
+    // Verify checksum
+    for (i = 0, sum = 0; i < (uint32_t)len + 5; i++)
+      sum += buf[i];
+    if (sum != 0) {
+      log (LOG_ERR, "HEX checksum error");
+      return -1;
+    }
+
+    type = buf[3];
+    switch (type) {
+      case 0: // Data
+        rv = Append (cb, arg, ext + ((buf[1] << 8) | buf[2]), &buf[4], len);
+        if (rv)
+          return rv;
+        break;
+      case 1: // EOF
+        return Flush (cb, arg);
+      case 2: // Extended segment address
+        ext = ((buf[4] << 8) | buf[5]) << 4;
+        break;
+      case 3: // Start segment address
+        entry = ((buf[4] << 8) | buf[5]) << 4;
+        entry += (buf[6] << 8) | buf[7];
+        has_entry = true;
+        break;
+      case 4: // Extended linear address
+        ext = ((buf[4] << 8) | buf[5]) << 16;
+        break;
+      case 5: // Start linear address
+        entry = (buf[4] << 24) | (buf[5] << 16) | (buf[6] << 8) | buf[7];
+        has_entry = true;
+        break;
+      default:
+        return -1;
+    }
+  }
+  return Flush (cb, arg);
+}
+
+int Image::WalkSrec (image_seg_t cb, void *arg)
+{
+  int rv, alen;
+  size_t off = 0;
+  uint8_t buf[260], sum, len, type;
+  uint32_t i, addr;
+
+  rec = (uint8_t *)malloc (IMAGE_REC_SZ);
+  if (!rec)
+    return -1;
+  rec_len = 0;
+
+  // STLL[AAAA..][DD...]CC
+  while ((off = next_rec (map, sz, off, 'S')) < sz) {
+    if (off + 4 > sz)
+      return -1;
+    type = map[off + 1];
+    off += 2;
+    if (hex2bin (&map[off], buf, 1))
+      return -1;
+    len = buf[0];
+    if ((off + ((len + 1) * 2) > sz) || hex2bin (&map[off], buf, len + 1))
+      return -1;
+    off += (len + 1) * 2;
+
+    // Verify checksum
+    for (i = 0, sum = 0; i < (uint32_t)len + 1; i++)
+      sum += buf[i];
+    if (sum != 0xFF) {
+      log (LOG_ERR, "SREC checksum error");
+      return -1;
+    }
+
+    // Address length by type
+    switch (type) {
+      case '1': case '9': alen = 2; break;
+      case '2': case '8': alen = 3; break;
+      case '3': case '7': alen = 4; break;
+      default:            alen = 0; break;
+    }
+    if (alen == 0)
+      continue;
+    if (len < alen + 1)
+      return -1;
+    for (i = 0, addr = 0; i < (uint32_t)alen; i++)
+      addr = (addr << 8) | buf[1 + i];
+    
+    // Data records
+    if ((type >= '1') && (type <= '3')) {
+      rv = Append (cb, arg, addr, &buf[1 + alen], len - alen - 1);
+      if (rv)
+        return rv;
+    }
+    // Termination with entry
+    else {
+      entry = addr;
+      has_entry = true;
+    }
+  }
+  return Flush (cb, arg);
+}
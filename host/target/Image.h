@@ -0,0 +1,78 @@
+/**
+ *  Memory mapped image parser. Walks loadable segments of ELF, Intel
+ *  HEX, SREC and raw binary files without copying the file.
+ *
+ *  All rights reserved.
+ *  Tiny Labs Inc
+ *  2022
+ */
+#ifndef IMAGE_H
+#define IMAGE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Image formats
+typedef enum {
+  IMAGE_AUTO = 0,
+  IMAGE_BIN  = 1,
+  IMAGE_ELF  = 2,
+  IMAGE_HEX  = 3,
+  IMAGE_SREC = 4
+} image_fmt_t;
+
+// Called for each contiguous segment - len bytes of data followed
+// by fill bytes of zero. Return non-zero to abort walk.
+typedef int (*image_seg_t) (void *arg, uint32_t addr, const uint8_t *data,
+                            uint32_t len, uint32_t fill);
+
+// Called for each symbol - function addr has Thumb bit cleared.
+// Return non-zero to stop walk.
+typedef int (*image_sym_t) (void *arg, const char *name, uint32_t addr,
+                            uint32_t size);
+
+class Image {
+ private:
+  int fd = -1;
+  const uint8_t *map = NULL;
+  size_t sz = 0;
+  image_fmt_t fmt = IMAGE_AUTO;
+  uint32_t base = 0;
+  uint32_t entry = 0;
+  bool has_entry = false;
+
+  // Staging for record based formats
+  uint8_t *rec = NULL;
+  uint32_t rec_addr = 0, rec_len = 0;
+  int Flush (image_seg_t cb, void *arg);
+  int Append (image_seg_t cb, void *arg, uint32_t addr, const uint8_t *data, uint32_t len);
+
+  int WalkElf (image_seg_t cb, void *arg);
+  int WalkHex (image_seg_t cb, void *arg);
+  int WalkSrec (image_seg_t cb, void *arg);
+  
+ public:
+  Image (void) {}
+  virtual ~Image ();
+
+  // Map file - base only used for raw binaries
+  int Open (const char *filename, uint32_t base, image_fmt_t fmt = IMAGE_AUTO);
+  void Close (void);
+
+  // Walk all segments in address order of file
+  int Walk (image_seg_t cb, void *arg);
+
+  // Walk sized function symbols of ELF symbol table - all defined
+  // symbols if all set
+  int Symbols (image_sym_t cb, void *arg, bool all = false);
+
+  // Look up any ELF symbol by name - size may be NULL
+  int Symbol (const char *name, uint32_t *addr, uint32_t *size);
+
+  // Image info
+  image_fmt_t Format (void) { return fmt; }
+  const char *FormatName (void);
+  bool Entry (uint32_t *entry);
+};
+
+#endif /* IMAGE_H */
@@ -0,0 +1,204 @@
+/**
+ *  Sample target variables at fixed rates while the core runs
+ *
+ *  All rights reserved.
+ *  Tiny Labs Inc
+ *  2022
+ */
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Logger.h"
+#include "log.h"
+
+static uint64_t now_ns (void)
+{
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ((uint64_t)ts.tv_sec * 1000000000ULL) + ts.tv_nsec;
+}
+
+Logger::Logger (Target *t)
+{
+  this->target = t;
+}
+
+Logger::~Logger ()
+{
+  int i;
+
+  Close ();
+  for (i = 0; i < cnt; i++)
+    free (var[i].name);
+  free (var);
+  free (col);
+  free (op);
+}
+
+int Logger::Add (const char *name, uint32_t addr, uint8_t width, uint32_t hz)
+{
+  var_t *v;
+
+  if (!name || !hz || ((width != 1) && (width != 2) && (width != 4)) ||
+      (addr & (width - 1)))
+    return -ERR_PARAMS;
+  v = (var_t *)realloc (var, (cnt + 1) * sizeof (var_t));
+  if (!v)
+    return -ERR_NOMEM;
+  var = v;
+  v = &var[cnt];
+  v->name = strdup (name);
+  v->addr = addr;
+  v->width = width;
+  v->idx = cnt;
+  v->period = 1000000000ULL / hz;
+  if (!v->name)
+    return -ERR_NOMEM;
+  cnt++;
+  return SUCCESS;
+}
+
+int Logger::Open (const char *filename, logger_fmt_t fmt)
+{
+  Close ();
+  fp = fopen (filename, fmt == LOGGER_CSV ? "w" : "wb");
+  if (!fp)
+    return -ERR_PARAMS;
+  this->fmt = fmt;
+  return SUCCESS;
+}
+
+void Logger::Close (void)
+{
+  if (fp)
+    fclose (fp);
+  fp = NULL;
+}
+
+void Logger::Emit (uint64_t usec)
+{
+  int i;
+  var_t *v;
+  logger_rec_t rec;
+
+  if (!fp)
+    return;
+
+  // CSV row per tick - blank if not due
+  if (fmt == LOGGER_CSV) {
+    fprintf (fp, "%llu", (unsigned long long)usec);
+    for (i = 0; i < cnt; i++) {
+      v = &var[col[i]];
+      if (v->hit)
+        fprintf (fp, ",%u", (op[v->op].data >> ((v->addr & 3) * 8)) &
+                 (0xFFFFFFFF >> (32 - (v->width * 8))));
+      else
+        fputc (',', fp);
+    }
+    fputc ('\n', fp);
+  }
+
+  // Binary record per sample
+  else {
+    for (i = 0; i < cnt; i++) {
+      v = &var[i];
+      if (!v->hit)
+        continue;
+      rec.usec = usec;
+      rec.idx = v->idx;
+      rec.value = (op[v->op].data >> ((v->addr & 3) * 8)) &
+        (0xFFFFFFFF >> (32 - (v->width * 8)));
+      fwrite (&rec, sizeof (rec), 1, fp);
+    }
+  }
+}
+
+int Logger::ByAddr (const void *a, const void *b)
+{
+  const var_t *va = (const var_t *)a, *vb = (const var_t *)b;
+  return (va->addr > vb->addr) - (va->addr < vb->addr);
+}
+
+int Logger::Run (double secs)
+{
+  int i, nop;
+  uint64_t start, end, t, next, skip;
+  struct timespec ts;
+
+  if (!cnt)
+    return -ERR_PARAMS;
+
+  // Address order so shared/adjacent words coalesce
+  qsort (var, cnt, sizeof (var_t), &ByAddr);
+  free (col);
+  free (op);
+  col = (int *)malloc (cnt * sizeof (int));
+  op = (flexsoc_op_t *)malloc (cnt * sizeof (flexsoc_op_t));
+  if (!col || !op)
+    return -ERR_NOMEM;
+  for (i = 0; i < cnt; i++) {
+    col[var[i].idx] = i;
+    var[i].due = 0;
+  }
+
+  // CSV header in add order
+  if (fp && (fmt == LOGGER_CSV)) {
+    fprintf (fp, "usec");
+    for (i = 0; i < cnt; i++)
+      fprintf (fp, ",%s", var[col[i]].name);
+    fputc ('\n', fp);
+  }
+
+  samples = ticks = missed = 0;
+  start = now_ns ();
+  end = (uint64_t)(secs * 1e9);
+  while (1) {
+
+    // Sleep until earliest deadline
+    for (i = 1, next = var[0].due; i < cnt; i++)
+      next = var[i].due < next ? var[i].due : next;
+    if (next >= end)
+      break;
+    t = now_ns () - start;
+    if (next > t) {
+      ts.tv_sec = (start + next) / 1000000000ULL;
+      ts.tv_nsec = (start + next) % 1000000000ULL;
+      clock_nanosleep (CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+      t = next;
+    }
+
+    // Collect due variables - one read per distinct word
+    for (i = 0, nop = 0; i < cnt; i++) {
+      var[i].hit = (var[i].due <= t);
+      if (!var[i].hit)
+        continue;
+      if (!nop || (op[nop - 1].addr != (var[i].addr & ~3)))
+        op[nop++] = {var[i].addr & ~3, 0, false};
+      var[i].op = nop - 1;
+      samples++;
+
+      // Next deadline - count whole periods we fell behind
+      var[i].due += var[i].period;
+      if (var[i].due <= t) {
+        skip = ((t - var[i].due) / var[i].period) + 1;
+        missed += skip;
+        var[i].due += skip * var[i].period;
+      }
+    }
+
+    // All due words in one round trip
+    target->Batch (op, nop);
+    Emit ((now_ns () - start) / 1000);
+    ticks++;
+  }
+
+  // Report what we achieved
+  this->secs = (now_ns () - start) / 1e9;
+  log (LOG_NORMAL, "Logger: %llu samples in %llu ticks %.3fs (%.0f samples/s) missed=%llu",
+       (unsigned long long)samples, (unsigned long long)ticks, this->secs,
+       Rate (), (unsigned long long)missed);
+  if (fp)
+    fflush (fp);
+  return SUCCESS;
+}
@@ -0,0 +1,83 @@
+/**
+ *  Sample target variables at fixed rates while the core runs. All
+ *  variables due on a tick are read in a single batch, with variables
+ *  sharing a word read once.
+ *
+ *  All rights reserved.
+ *  Tiny Labs Inc
+ *  2022
+ */
+#include <stdio.h>
+#include <time.h>
+
+#include "Target.h"
+#include "Debug.h"
+
+#ifndef LOGGER_H
+#define LOGGER_H
+
+// Output formats
+typedef enum {
+  LOGGER_CSV = 0,
+  LOGGER_BIN = 1
+} logger_fmt_t;
+
+// Binary record - one per sample
+typedef struct {
+  uint64_t usec;   // Time since start
+  uint32_t idx;    // Variable index in order added
+  uint32_t value;  // Zero extended
+} logger_rec_t;
+
+class Logger {
+ private:
+  Target *target;
+
+  // Variables sorted by address at start
+  typedef struct {
+    char *name;
+    uint32_t addr;
+    uint8_t width;
+    uint32_t idx;
+    uint64_t period, due;  // ns
+    int op;                // Batch word holding variable
+    bool hit;              // Sampled this tick
+  } var_t;
+  var_t *var = NULL;
+  int *col = NULL;         // Add order => sorted index
+  int cnt = 0;
+
+  // Per tick batch
+  flexsoc_op_t *op = NULL;
+
+  FILE *fp = NULL;
+  logger_fmt_t fmt = LOGGER_CSV;
+
+  // Statistics of last run
+  uint64_t samples = 0, ticks = 0, missed = 0;
+  double secs = 0;
+
+  void Emit (uint64_t usec);
+  static int ByAddr (const void *a, const void *b);
+  
+ public:
+  Logger (Target *t);
+  virtual ~Logger ();
+
+  // Sample width bytes (1/2/4, naturally aligned) at addr hz times/s
+  int Add (const char *name, uint32_t addr, uint8_t width, uint32_t hz);
+
+  // Stream samples to file
+  int Open (const char *filename, logger_fmt_t fmt);
+  void Close (void);
+
+  // Sample until secs elapsed
+  int Run (double secs);
+
+  // Results of last run
+  double Rate (void) { return secs > 0 ? samples / secs : 0; }
+  uint64_t Samples (void) { return samples; }
+  uint64_t Missed (void) { return missed; }
+};
+
+#endif /* LOGGER_H */
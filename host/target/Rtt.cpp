@@ -0,0 +1,215 @@
+/**
+ *  Read RTT up-channels from a running target
+ *
+ *  All rights reserved.
+ *  Tiny Labs Inc
+ *  2022
+ */
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "Rtt.h"
+#include "log.h"
+
+// Control block ID - NUL terminated
+static const char rtt_id[] = "SEGGER RTT";
+#define RTT_ID_SZ      16
+
+// Control block header: ID + MaxNumUpBuffers + MaxNumDownBuffers
+#define RTT_HDR_WORDS  6
+
+// Up buffer descriptor: sName, pBuffer, SizeOfBuffer, WrOff, RdOff, Flags
+#define RTT_DESC_WORDS 6
+#define RTT_DESC_BUF   1
+#define RTT_DESC_SIZE  2
+#define RTT_DESC_WR    3
+#define RTT_DESC_RD    4
+
+// Search chunk - overlaps by ID size so no match straddles chunks
+#define RTT_SCAN_SZ    (64 * 1024)
+
+static uint64_t now_us (void)
+{
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ((uint64_t)ts.tv_sec * 1000000ULL) + (ts.tv_nsec / 1000);
+}
+
+Rtt::Rtt (Target *t)
+{
+  this->target = t;
+}
+
+Rtt::~Rtt ()
+{
+  free (stage);
+}
+
+int Rtt::Find (uint32_t addr, uint32_t len)
+{
+  uint32_t *buf, cnt, off;
+  uint8_t *hit;
+
+  buf = (uint32_t *)malloc (RTT_SCAN_SZ);
+  if (!buf)
+    return -ERR_NOMEM;
+
+  // Control block is word aligned
+  addr &= ~3;
+  len &= ~3;
+  while (len >= RTT_ID_SZ) {
+    cnt = len > RTT_SCAN_SZ ? RTT_SCAN_SZ : len;
+    target->ReadW (addr, buf, cnt / 4);
+    for (off = 0; off + RTT_ID_SZ <= cnt; off = (hit - (uint8_t *)buf) + 4) {
+      hit = (uint8_t *)memmem ((uint8_t *)buf + off, cnt - off, rtt_id, sizeof (rtt_id));
+      if (!hit)
+        break;
+      if (((hit - (uint8_t *)buf) & 3) == 0) {
+        free (buf);
+        return Attach (addr + (hit - (uint8_t *)buf));
+      }
+      hit = (uint8_t *)(((uintptr_t)hit) & ~3);
+    }
+    if (cnt == len)
+      break;
+    addr += cnt - RTT_ID_SZ;
+    len -= cnt - RTT_ID_SZ;
+  }
+  free (buf);
+  return -ERR_UNKNOWN;
+}
+
+int Rtt::Attach (uint32_t addr)
+{
+  int i;
+  uint32_t hdr[RTT_HDR_WORDS], max = 0;
+  uint32_t desc[RTT_MAX_UP * RTT_DESC_WORDS];
+
+  // Validate header
+  target->ReadW (addr, hdr, RTT_HDR_WORDS);
+  if (memcmp (hdr, rtt_id, sizeof (rtt_id)))
+    return -ERR_PARAMS;
+  nup = hdr[4] > RTT_MAX_UP ? RTT_MAX_UP : hdr[4];
+  cb = addr;
+
+  // Cache geometry of all up-channels in one read
+  if (nup)
+    target->ReadW (addr + (RTT_HDR_WORDS * 4), desc, nup * RTT_DESC_WORDS);
+  for (i = 0; i < nup; i++) {
+    up[i].desc = addr + ((RTT_HDR_WORDS + (i * RTT_DESC_WORDS)) * 4);
+    up[i].buf = desc[(i * RTT_DESC_WORDS) + RTT_DESC_BUF];
+    up[i].size = desc[(i * RTT_DESC_WORDS) + RTT_DESC_SIZE];
+    up[i].rd = desc[(i * RTT_DESC_WORDS) + RTT_DESC_RD];
+    if (up[i].rd >= up[i].size)
+      up[i].rd = 0;
+    max = up[i].size > max ? up[i].size : max;
+    log (LOG_DEBUG, "RTT: up%d buf=%08X size=%u", i, up[i].buf, up[i].size);
+  }
+
+  // Staging large enough for any span plus alignment
+  free (stage);
+  stage_sz = max + 8;
+  stage = (uint32_t *)malloc (stage_sz);
+  if (!stage)
+    return -ERR_NOMEM;
+  log (LOG_DEBUG, "RTT: control block at %08X", cb);
+  return SUCCESS;
+}
+
+int Rtt::ReadSpan (uint32_t addr, uint8_t *data, uint32_t len)
+{
+  uint32_t start, words;
+
+  // One sequential word read covering span
+  start = addr & ~3;
+  words = (((addr + len + 3) & ~3) - start) / 4;
+  if ((words * 4) > stage_sz)
+    return -ERR_PARAMS;
+  target->ReadW (start, stage, words);
+  memcpy (data, (uint8_t *)stage + (addr & 3), len);
+  return SUCCESS;
+}
+
+int Rtt::Poll (int ch, uint8_t *data, uint32_t max)
+{
+  chan_t *c;
+  uint32_t wr, cnt, first;
+
+  if ((ch < 0) || (ch >= nup) || !data)
+    return -ERR_PARAMS;
+  c = &up[ch];
+
+  // Only the write offset is read when idle
+  target->ReadW (c->desc + (RTT_DESC_WR * 4), &wr, 1);
+  if (wr >= c->size)
+    return -ERR_UNKNOWN;
+  if (wr == c->rd)
+    return 0;
+
+  // New bytes - split on wrap
+  cnt = (wr + c->size - c->rd) % c->size;
+  cnt = cnt > max ? max : cnt;
+  first = c->size - c->rd;
+  first = first > cnt ? cnt : first;
+  if (ReadSpan (c->buf + c->rd, data, first) ||
+      ((cnt > first) && ReadSpan (c->buf, data + first, cnt - first)))
+    return -ERR_PARAMS;
+
+  // Release space to target
+  c->rd = (c->rd + cnt) % c->size;
+  target->WriteW (c->desc + (RTT_DESC_RD * 4), &c->rd, 1);
+  return cnt;
+}
+
+int Rtt::Run (int ch, FILE *fp, double secs)
+{
+  int n;
+  uint8_t *data;
+  uint32_t half;
+  uint64_t start, end, t, interval = 1000;
+
+  if ((ch < 0) || (ch >= nup))
+    return -ERR_PARAMS;
+  data = (uint8_t *)malloc (up[ch].size);
+  if (!data)
+    return -ERR_NOMEM;
+  half = up[ch].size / 2;
+  half = half ? half : 1;
+
+  bytes = 0;
+  start = now_us ();
+  end = start + (uint64_t)(secs * 1e6);
+  for (t = start; t < end; t = now_us ()) {
+    n = Poll (ch, data, up[ch].size);
+    if (n < 0) {
+      free (data);
+      return n;
+    }
+    if (n && fp)
+      fwrite (data, 1, n, fp);
+    bytes += n;
+
+    // Aim for buffer half full at each poll
+    if (!n)
+      interval *= 2;
+    else
+      interval = (interval * half) / n;
+    if (interval < RTT_POLL_MIN)
+      interval = RTT_POLL_MIN;
+    else if (interval > RTT_POLL_MAX)
+      interval = RTT_POLL_MAX;
+    usleep (interval);
+  }
+  if (fp)
+    fflush (fp);
+  free (data);
+
+  // Report what we achieved
+  this->secs = (now_us () - start) / 1e6;
+  log (LOG_NORMAL, "RTT: %llu bytes in %.3fs (%.1f KB/s)",
+       (unsigned long long)bytes, this->secs, Rate () / 1024);
+  return SUCCESS;
+}
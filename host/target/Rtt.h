@@ -0,0 +1,77 @@
+/**
+ *  Read RTT up-channels from a running target. The control block is
+ *  located once and the buffer geometry cached, so each poll reads the
+ *  write offset, the new bytes in one sequential read (two on wrap) and
+ *  writes back the read offset.
+ *
+ *  All rights reserved.
+ *  Tiny Labs Inc
+ *  2022
+ */
+#include <stdio.h>
+
+#include "Target.h"
+#include "Debug.h"
+
+#ifndef RTT_H
+#define RTT_H
+
+// Up-channels cached
+#define RTT_MAX_UP     16
+
+// Poll interval limits in us
+#define RTT_POLL_MIN   100
+#define RTT_POLL_MAX   50000
+
+class Rtt {
+ private:
+  Target *target;
+
+  // Cached up-channel geometry
+  typedef struct {
+    uint32_t desc;   // Descriptor address
+    uint32_t buf;    // Ring buffer
+    uint32_t size;
+    uint32_t rd;     // Host owns read offset
+  } chan_t;
+  chan_t up[RTT_MAX_UP];
+  int nup = 0;
+  uint32_t cb = 0;
+
+  // Word staging for unaligned spans
+  uint32_t *stage = NULL;
+  uint32_t stage_sz = 0;
+
+  // Statistics of last run
+  uint64_t bytes = 0;
+  double secs = 0;
+
+  int ReadSpan (uint32_t addr, uint8_t *data, uint32_t len);
+
+ public:
+  Rtt (Target *t);
+  virtual ~Rtt ();
+
+  // Search len bytes of RAM at addr for control block
+  int Find (uint32_t addr, uint32_t len);
+
+  // Control block at known address
+  int Attach (uint32_t addr);
+
+  // Channel info - valid after Find/Attach
+  uint32_t Address (void) { return cb; }
+  int Channels (void) { return nup; }
+  uint32_t Size (int ch) { return ((ch >= 0) && (ch < nup)) ? up[ch].size : 0; }
+
+  // Copy up to max new bytes - returns count or error
+  int Poll (int ch, uint8_t *data, uint32_t max);
+
+  // Stream channel to file for secs, adapting poll rate to data rate
+  int Run (int ch, FILE *fp, double secs);
+
+  // Results of last run
+  double Rate (void) { return secs > 0 ? bytes / secs : 0; }
+  uint64_t Bytes (void) { return bytes; }
+};
+
+#endif /* RTT_H */
@@ -0,0 +1,353 @@
+/**
+ *  ARM semihosting served from gateware halt notifications
+ *
+ *  All rights reserved.
+ *  Tiny Labs Inc
+ *  2022
+ */
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "Semihost.h"
+#include "log.h"
+
+// Semihosting call - bkpt #0xAB
+#define SEMI_BKPT      0xBEAB
+
+// Bulk transfer size for console and file data
+#define SEMI_CHUNK     (64 * 1024)
+
+// SYS_WRITE0 read size - power of two so chunks never cross a 1KB
+// boundary and can't run past the end of the region holding the string
+#define SEMI_STR_CHUNK 64
+
+// Max words in any parameter block
+#define SEMI_MAX_PARAM 3
+
+// Parameter block words per operation
+static int param_words (uint32_t op)
+{
+  switch (op) {
+    case SYS_OPEN:
+    case SYS_WRITE:
+    case SYS_READ:
+      return 3;
+    case SYS_SEEK:
+    case SYS_REMOVE:
+      return 2;
+    case SYS_CLOSE:
+    case SYS_ISERROR:
+    case SYS_ISTTY:
+    case SYS_FLEN:
+      return 1;
+    default:
+      return 0;
+  }
+}
+
+static double elapsed (struct timespec *start)
+{
+  struct timespec now;
+
+  clock_gettime (CLOCK_MONOTONIC, &now);
+  return (now.tv_sec - start->tv_sec) + ((now.tv_nsec - start->tv_nsec) / 1e9);
+}
+
+Semihost::Semihost (Target *t, Debug *d)
+{
+  this->target = t;
+  this->debug = d;
+  memset (file, 0, sizeof (file));
+}
+
+Semihost::~Semihost ()
+{
+  int i;
+
+  // Close files target left open
+  for (i = 0; i < SEMI_MAX_FILES; i++)
+    if (file[i] && (file[i] != stdin) && (file[i] != stdout) && (file[i] != stderr))
+      fclose (file[i]);
+}
+
+FILE *Semihost::Handle (uint32_t h)
+{
+  if ((h < 1) || (h > SEMI_MAX_FILES))
+    return NULL;
+  return file[h - 1];
+}
+
+int Semihost::Console (FILE *fp, const uint8_t *data, uint32_t len)
+{
+  // Redirect target stdout/stderr and count throughput
+  if ((fp == stdout) || (fp == stderr)) {
+    fp = console;
+    console_bytes += len;
+  }
+  return fwrite (data, 1, len, fp);
+}
+
+uint32_t Semihost::Write0 (uint32_t addr)
+{
+  uint8_t buf[SEMI_STR_CHUNK];
+  uint8_t *end;
+  uint32_t cnt;
+
+  // Read aligned chunks until NUL found - stop on fault
+  do {
+    cnt = SEMI_STR_CHUNK - (addr & (SEMI_STR_CHUNK - 1));
+    if (debug->ReadMem (addr, buf, cnt)) {
+      err = EFAULT;
+      break;
+    }
+    end = (uint8_t *)memchr (buf, 0, cnt);
+    if (end)
+      cnt = end - buf;
+    Console (stdout, buf, cnt);
+    addr += cnt;
+  } while (!end);
+  return 0;
+}
+
+uint32_t Semihost::Transfer (FILE *fp, uint32_t addr, uint32_t len, bool write)
+{
+  uint8_t *buf;
+  uint32_t cnt, done;
+
+  buf = (uint8_t *)malloc (SEMI_CHUNK);
+  if (!buf)
+    return len;
+
+  // Move data in bulk chunks - return bytes not transferred
+  while (len) {
+    cnt = len > SEMI_CHUNK ? SEMI_CHUNK : len;
+    if (write) {
+      if (debug->ReadMem (addr, buf, cnt)) {
+        err = EFAULT;
+        break;
+      }
+      done = Console (fp, buf, cnt);
+    }
+    else {
+      done = fread (buf, 1, cnt, fp);
+      if (done && debug->WriteMem (addr, buf, done)) {
+        err = EFAULT;
+        break;
+      }
+    }
+    addr += done;
+    len -= done;
+    if (done != cnt) {
+      err = errno;
+      break;
+    }
+  }
+  free (buf);
+  if (write)
+    fflush (fp == stdout ? console : fp);
+  return len;
+}
+
+uint32_t Semihost::Open (uint32_t name, uint32_t mode, uint32_t len)
+{
+  static const char *fmode[12] = {
+    "r", "rb", "r+", "r+b", "w", "wb", "w+", "w+b", "a", "ab", "a+", "a+b"
+  };
+  char *path;
+  FILE *fp;
+  int h;
+
+  // Find free handle
+  for (h = 0; h < SEMI_MAX_FILES; h++)
+    if (!file[h])
+      break;
+  if ((h == SEMI_MAX_FILES) || (mode > 11)) {
+    err = EINVAL;
+    return 0xFFFFFFFF;
+  }
+
+  path = (char *)malloc (len + 1);
+  if (!path) {
+    err = ENOMEM;
+    return 0xFFFFFFFF;
+  }
+  if (debug->ReadMem (name, (uint8_t *)path, len)) {
+    free (path);
+    err = EFAULT;
+    return 0xFFFFFFFF;
+  }
+  path[len] = '\0';
+
+  // Special name maps to stdio by mode
+  if (!strcmp (path, ":tt"))
+    fp = (mode < 4) ? stdin : ((mode < 8) ? stdout : stderr);
+  else
+    fp = fopen (path, fmode[mode]);
+  free (path);
+  if (!fp) {
+    err = errno;
+    return 0xFFFFFFFF;
+  }
+  file[h] = fp;
+  return h + 1;
+}
+
+uint32_t Semihost::Service (uint32_t op, uint32_t arg, const uint32_t *param)
+{
+  FILE *fp = NULL;
+  uint8_t c;
+  char *path;
+  struct stat st;
+  int rv;
+
+  // Validate handle for operations taking one
+  switch (op) {
+    case SYS_CLOSE:
+    case SYS_WRITE:
+    case SYS_READ:
+    case SYS_ISTTY:
+    case SYS_SEEK:
+    case SYS_FLEN:
+      fp = Handle (param[0]);
+      if (!fp) {
+        err = EBADF;
+        return 0xFFFFFFFF;
+      }
+  }
+
+  switch (op) {
+    case SYS_OPEN:
+      return Open (param[0], param[1], param[2]);
+    case SYS_CLOSE:
+      file[param[0] - 1] = NULL;
+      if ((fp == stdin) || (fp == stdout) || (fp == stderr))
+        return 0;
+      return fclose (fp) ? 0xFFFFFFFF : 0;
+    case SYS_WRITEC:
+      if (target->TryReadB (arg, &c, 1)) {
+        err = EFAULT;
+        return 0;
+      }
+      Console (stdout, &c, 1);
+      fflush (console);
+      return 0;
+    case SYS_WRITE0:
+      Write0 (arg);
+      fflush (console);
+      return 0;
+    case SYS_WRITE:
+      return Transfer (fp, param[1], param[2], true);
+    case SYS_READ:
+      return Transfer (fp, param[1], param[2], false);
+    case SYS_READC:
+      return getchar ();
+    case SYS_ISERROR:
+      return (int32_t)param[0] < 0;
+    case SYS_ISTTY:
+      return isatty (fileno (fp));
+    case SYS_SEEK:
+      if (fseek (fp, param[1], SEEK_SET)) {
+        err = errno;
+        return 0xFFFFFFFF;
+      }
+      return 0;
+    case SYS_FLEN:
+      if (fstat (fileno (fp), &st)) {
+        err = errno;
+        return 0xFFFFFFFF;
+      }
+      return st.st_size;
+    case SYS_REMOVE:
+      path = (char *)malloc (param[1] + 1);
+      if (!path)
+        return 0xFFFFFFFF;
+      if (debug->ReadMem (param[0], (uint8_t *)path, param[1])) {
+        free (path);
+        err = EFAULT;
+        return 0xFFFFFFFF;
+      }
+      path[param[1]] = '\0';
+      rv = remove (path);
+      if (rv)
+        err = errno;
+      free (path);
+      return rv ? 0xFFFFFFFF : 0;
+    case SYS_CLOCK:
+      return (uint32_t)(elapsed (&start) * 100);
+    case SYS_TIME:
+      return (uint32_t)time (NULL);
+    case SYS_ERRNO:
+      return err;
+    default:
+      log (LOG_DEBUG, "Semihost: unsupported op %02X", op);
+      return 0xFFFFFFFF;
+  }
+}
+
+int Semihost::Run (int ms, uint32_t *status)
+{
+  int rc, i, n, left;
+  const reg_t rd[3] = {REG_R0, REG_R1, REG_PC};
+  const reg_t wr[2] = {REG_R0, REG_PC};
+  uint32_t val[3], param[SEMI_MAX_PARAM], insn;
+  flexsoc_op_t op[SEMI_MAX_PARAM + 1];
+
+  // Wake on gateware halt notification instead of polling
+  debug->WatchHalt (true);
+  console_bytes = 0;
+  clock_gettime (CLOCK_MONOTONIC, &start);
+
+  for (;;) {
+    left = ms - (int)(elapsed (&start) * 1000);
+    rc = debug->WaitHalt (left > 0 ? left : 0);
+    if (rc)
+      break;
+
+    // Operation, argument and PC in one batch
+    if (debug->RegReadMulti (rd, val, 3)) {
+      rc = -ERR_TIMEOUT;
+      break;
+    }
+
+    // Trapping instruction and parameter block in one batch
+    n = (val[1] & 3) ? 0 : param_words (val[0]);
+    memset (param, 0, sizeof (param));
+    op[0] = {val[2] & ~3, 0, false};
+    for (i = 0; i < n; i++)
+      op[i + 1] = {val[1] + (i * 4), 0, false};
+    target->Batch (op, n + 1);
+    insn = (val[2] & 2) ? (op[0].data >> 16) : (op[0].data & 0xFFFF);
+    if (insn != SEMI_BKPT) {
+      rc = SEMI_HALT;
+      break;
+    }
+    for (i = 0; i < n; i++)
+      param[i] = op[i + 1].data;
+
+    // Leave core halted on exit
+    if (val[0] == SYS_EXIT) {
+      if (status)
+        *status = (val[1] == ADP_STOPPED_APPEXIT) ? 0 : val[1];
+      rc = SEMI_EXIT;
+      break;
+    }
+
+    // Return result and step over BKPT
+    val[0] = Service (val[0], val[1], param);
+    val[1] = val[2] + 2;
+    if (debug->RegWriteMulti (wr, val, 2)) {
+      rc = -ERR_TIMEOUT;
+      break;
+    }
+    debug->Resume ();
+  }
+
+  secs = elapsed (&start);
+  log (LOG_DEBUG, "Semihost: %llu console bytes in %.3fs (%.1f KB/s)",
+       (unsigned long long)console_bytes, secs, ConsoleRate () / 1024);
+  return rc;
+}
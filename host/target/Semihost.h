@@ -0,0 +1,84 @@
+/**
+ *  ARM semihosting served from gateware halt notifications. Register
+ *  state and the parameter block of each call are fetched in batched
+ *  transfers, console and file data move as bulk memory transfers.
+ *
+ *  All rights reserved.
+ *  Tiny Labs Inc
+ *  2022
+ */
+#include <stdio.h>
+#include <time.h>
+
+#include "Target.h"
+#include "Debug.h"
+
+#ifndef SEMIHOST_H
+#define SEMIHOST_H
+
+// Semihosting operations
+#define SYS_OPEN      0x01
+#define SYS_CLOSE     0x02
+#define SYS_WRITEC    0x03
+#define SYS_WRITE0    0x04
+#define SYS_WRITE     0x05
+#define SYS_READ      0x06
+#define SYS_READC     0x07
+#define SYS_ISERROR   0x08
+#define SYS_ISTTY     0x09
+#define SYS_SEEK      0x0A
+#define SYS_FLEN      0x0C
+#define SYS_REMOVE    0x0E
+#define SYS_CLOCK     0x10
+#define SYS_TIME      0x11
+#define SYS_ERRNO     0x13
+#define SYS_EXIT      0x18
+
+// SYS_EXIT reason for normal application exit
+#define ADP_STOPPED_APPEXIT  0x20026
+
+// Open file handles - handle is index + 1
+#define SEMI_MAX_FILES  16
+
+// Run results other than errors
+#define SEMI_EXIT   0   // Application called SYS_EXIT
+#define SEMI_HALT   1   // Halted on something other than a semihost call
+
+class Semihost {
+ private:
+  Target *target;
+  Debug *debug;
+
+  FILE *file[SEMI_MAX_FILES];
+  FILE *console = stdout;
+  int err = 0;
+
+  // Console statistics of last run
+  uint64_t console_bytes = 0;
+  double secs = 0;
+  struct timespec start;
+
+  FILE *Handle (uint32_t h);
+  int Console (FILE *fp, const uint8_t *data, uint32_t len);
+  uint32_t Write0 (uint32_t addr);
+  uint32_t Transfer (FILE *fp, uint32_t addr, uint32_t len, bool write);
+  uint32_t Open (uint32_t name, uint32_t mode, uint32_t len);
+  uint32_t Service (uint32_t op, uint32_t arg, const uint32_t *param);
+
+ public:
+  Semihost (Target *t, Debug *d);
+  virtual ~Semihost ();
+
+  // Send target stdout/stderr here instead of host stdout
+  void SetConsole (FILE *fp) { console = fp; }
+
+  // Serve calls until exit, other halt or ms elapsed. Core must be
+  // running or halted on a semihost BKPT.
+  int Run (int ms, uint32_t *status);
+
+  // Console throughput of last run
+  uint64_t ConsoleBytes (void) { return console_bytes; }
+  double ConsoleRate (void) { return secs > 0 ? console_bytes / secs : 0; }
+};
+
+#endif /* SEMIHOST_H */
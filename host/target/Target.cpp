@@ -6,6 +6,8 @@
  *  2020
  */
 #include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
 #include <cassert>
 
 #include "Target.h"
@@ -18,16 +20,57 @@ Target *Target::inst = NULL;
 
 // Single callback instance
 static irq_handler_t cb = NULL;
+static halt_handler_t halt_cb = NULL;
 static void flexsoc_irq_convert (uint8_t *buf, int len)
 {
-    // Assert we have a valid callback
-    assert (cb != NULL);
-  
-    // Make sure length is 2
-    assert (len == 2);
+    // IRQ from bridge scan: ctl, irq
+    if ((len == 2) && cb)
+        cb (buf[0], buf[1]);
+
+    // DHCSR watch: hdr, DHCSR (big endian)
+    else if ((len == 5) && halt_cb)
+        halt_cb ((buf[1] << 24) | (buf[2] << 16) | (buf[3] << 8) | buf[4]);
+}
+
+// Cached AP registers
+#define CACHE_CSW  1
+#define CACHE_TAR  2
+
+// CSW fields
+#define CSW_SIZE(x)     ((x) & 7)
+#define CSW_ADDRINC(x)  (((x) >> 4) & 3)
+
+// TAR auto-increment only guaranteed within 1KB
+#define TAR_WRAP        0x3FF
 
-    // Pass IRQ to callback
-    cb (buf[0], buf[1]);
+// Priv data word access - auto-increment for block transfers
+#define CSW_DEFAULT     0xA3000042
+#define CSW_BLOCK       (CSW_DEFAULT | (1 << 4))
+
+// WAIT retries in gateware set at connect
+#define ADIv5_RETRY_DEFAULT  8
+
+// Words queued per MEM-AP flush without bridge
+#define MEMAP_BLOCK     1024
+
+// Clock negotiation - read-back words and passes per step
+#define CLK_CHECK_WORDS 8
+#define CLK_CHECK_PASS  4
+static const uint32_t clk_pattern[CLK_CHECK_WORDS] = {
+    0xAAAAAAAA, 0x55555555, 0xFFFFFFFF, 0x00000000,
+    0x01234567, 0x89ABCDEF, 0xFEDCBA98, 0x76543210
+};
+
+// Record address of CSR accessed - layout owned by CSR generator
+static uint32_t csr_addr;
+static uint32_t csr_addr_read (uint32_t addr)
+{
+    csr_addr = addr;
+    return 0;
+}
+static void csr_addr_write (uint32_t addr, const uint32_t data)
+{
+    csr_addr = addr;
 }
 
 Target::Target (char *id)
@@ -42,15 +85,31 @@ Target::Target (char *id)
     if (!csr)
         log (LOG_FATAL, "Failed to inst flexsoc_csr");
 
+    // Find ADIv5 CSRs so operations can be batched
+    flexdbg_csr probe (CSR_BASE, &csr_addr_read, &csr_addr_write);
+    probe.adiv5_cmd (0);
+    adiv5_cmd_addr = csr_addr;
+    probe.adiv5_data (0);
+    adiv5_data_addr = csr_addr;
+    probe.adiv5_status ();
+    adiv5_status_addr = csr_addr;
+    Invalidate ();
+    bridge = csr->bridge_en ();
+    phy_div = csr->phy_div ();
+
     // Validate CSR matches
     if (Validate () != 0)
         log (LOG_FATAL, "CSR Mismatch - regen gateware/csr");
+
+    // Absorb WAIT in gateware instead of failing back to host
+    SetRetry (ADIv5_RETRY_DEFAULT);
 }
 
 Target::~Target ()
 {
     // Delete CSR classes
     delete csr;
+    free (queue);
     
     // Close comm link
     flexsoc_close ();
@@ -80,41 +139,34 @@ bool Target::Validate (void)
 int Target::EnableAP (bool do_enable)
 {
     int i;
-    uint32_t val;
+    uint32_t val, want;
 
     log (LOG_TRACE, "EnableAP: %d", do_enable);
   
-    // Write to enable AP
-    if (do_enable) {
-        if (WriteDP (4, 0x50000000) == ADIv5_OK)
-            return -1;
-        for (i = 0; i < timeout; i++) {
-            if (ReadDP (4, &val) == ADIv5_OK)
-                return -1;
-            if ((val & 0xF0000000) == 0xF0000000)
-                break;
-        }
-    }
-    // Disable AP
-    else {
-        if (WriteDP (4, 0x00000000) == ADIv5_OK)
+    // Request power up/down and poll acks. With WAIT retried in gateware
+    // all polls go out in one stream, else one read per round trip.
+    want = do_enable ? 0xF0000000 : 0x00000000;
+    QueueWriteDP (4, do_enable ? 0x50000000 : 0x00000000);
+    for (i = 0; i < (retry ? timeout : 1); i++)
+        QueueReadDP (4, &val);
+    if (QueueFlush () != ADIv5_OK)
+        return -1;
+    for (i = 0; !retry && (i < timeout); i++) {
+        if ((val & 0xF0000000) == want)
+            break;
+        if (ReadDP (4, &val) != ADIv5_OK)
             return -1;
-        for (i = 0; i < timeout; i++) {
-            if (ReadDP (4, &val) == ADIv5_OK)
-                return -1;
-            if ((val & 0xF0000000) == 0x00000000)
-                break;
-        }
     }
+
     // Check if we timed out
-    if (i == timeout) {
+    if ((val & 0xF0000000) != want) {
         log (LOG_TRACE, "Timed Out");
         return -1;
     }
 
     // Setup default CSW - Priv data word access
-    if (do_enable)
-        WriteAP (0, 0xA3000042);
+    if (do_enable && (WriteAP (0, CSW_DEFAULT) != ADIv5_OK))
+        return -1;
 
     // Save status
     ap_enabled = do_enable;
@@ -124,8 +176,54 @@ int Target::EnableAP (bool do_enable)
 // General APIs
 void Target::ReadW (uint32_t addr, uint32_t *data, uint32_t cnt)
 {
-    if (flexsoc_readw (addr, data, cnt))
-        log (LOG_FATAL, "flexsoc_readw failed!");
+    if (TryReadW (addr, data, cnt))
+        log (LOG_FATAL, "ReadW failed: %08X", addr);
+}
+
+int Target::TryReadW (uint32_t addr, uint32_t *data, uint32_t cnt)
+{
+    if (!bridge)
+        return (MemAP (addr, data, cnt, false) == ADIv5_OK) ? 0 : -1;
+    if (!flexsoc_readw (addr, data, cnt))
+        return 0;
+
+    // Clear sticky error left by bus fault
+    WriteDP (0, 0x1E);
+    return -1;
+}
+
+int Target::TryReadB (uint32_t addr, uint8_t *data, uint32_t cnt)
+{
+    uint32_t base, words, *buf;
+    int rv;
+
+    if (bridge) {
+        if (!flexsoc_readb (addr, data, cnt))
+            return 0;
+        WriteDP (0, 0x1E);
+        return -1;
+    }
+    if (!cnt)
+        return 0;
+
+    // MEM-AP moves words - read covering words and pick out bytes
+    base = addr & ~3;
+    words = ((addr + cnt + 3) & ~3) - base;
+    words /= 4;
+    buf = (uint32_t *)malloc (words * 4);
+    if (!buf)
+        return -1;
+    rv = (MemAP (base, buf, words, false) == ADIv5_OK) ? 0 : -1;
+    if (!rv)
+        memcpy (data, (uint8_t *)buf + (addr - base), cnt);
+    free (buf);
+    return rv;
+}
+
+void Target::ReadWFixed (uint32_t addr, uint32_t *data, uint32_t cnt)
+{
+    if (flexsoc_readw_fixed (addr, data, cnt))
+        log (LOG_FATAL, "flexsoc_readw_fixed failed!");
 }
 
 void Target::ReadH (uint32_t addr, uint16_t *data, uint32_t cnt)
@@ -142,8 +240,53 @@ void Target::ReadB (uint32_t addr, uint8_t *data, uint32_t cnt)
 
 void Target::WriteW (uint32_t addr, const uint32_t *data, uint32_t cnt)
 {
-    if (flexsoc_writew (addr, data, cnt))
-        log (LOG_FATAL, "flexsoc_writew failed!");
+    if (TryWriteW (addr, data, cnt))
+        log (LOG_FATAL, "WriteW failed: %08X", addr);
+}
+
+int Target::TryWriteW (uint32_t addr, const uint32_t *data, uint32_t cnt)
+{
+    if (!bridge)
+        return (MemAP (addr, (uint32_t *)data, cnt, true) == ADIv5_OK) ? 0 : -1;
+    if (!flexsoc_writew (addr, data, cnt))
+        return 0;
+    WriteDP (0, 0x1E);
+    return -1;
+}
+
+// Word transfers through MEM-AP DRW when bridge is disabled
+adiv5_stat_t Target::MemAP (uint32_t addr, uint32_t *data, uint32_t cnt, bool write)
+{
+    uint32_t i;
+    adiv5_stat_t rv = ADIv5_OK;
+
+    // Single auto-increment - skipped if CSW already set
+    QueueWriteAP (0, CSW_BLOCK);
+    for (i = 0; i < cnt; i++) {
+
+        // TAR only goes out when cache lost it at the 1KB boundary
+        QueueWriteAP (4, addr + (i * 4));
+        if (write)
+            QueueWriteAP (0xC, data[i]);
+        else
+            QueueReadAP (0xC, &data[i]);
+
+        // Bound queue - each flush is one pipelined stream
+        if (((i + 1) % MEMAP_BLOCK) == 0) {
+            rv = QueueFlush ();
+            if (rv != ADIv5_OK)
+                break;
+        }
+    }
+    if (rv == ADIv5_OK)
+        rv = QueueFlush ();
+
+    // Clear sticky errors so the fault doesn't block later accesses
+    if (rv != ADIv5_OK) {
+        log (LOG_DEBUG, "MEM-AP %s failed: %08X", write ? "write" : "read", addr);
+        WriteDP (0, 0x1E);
+    }
+    return rv;
 }
 
 void Target::WriteH (uint32_t addr, const uint16_t *data, uint32_t cnt)
@@ -154,8 +297,30 @@ void Target::WriteH (uint32_t addr, const uint16_t *data, uint32_t cnt)
 
 void Target::WriteB (uint32_t addr, const uint8_t *data, uint32_t cnt)
 {
-    if (flexsoc_writeb (addr, data, cnt))
-        log (LOG_FATAL, "flexsoc_writeb failed!");
+    if (TryWriteB (addr, data, cnt))
+        log (LOG_FATAL, "WriteB failed: %08X", addr);
+}
+
+int Target::TryWriteB (uint32_t addr, const uint8_t *data, uint32_t cnt)
+{
+    if (!flexsoc_writeb (addr, data, cnt))
+        return 0;
+    WriteDP (0, 0x1E);
+    return -1;
+}
+
+void Target::Fill (uint32_t addr, uint32_t value, uint8_t width, uint32_t cnt)
+{
+    if (TryFill (addr, value, width, cnt))
+        log (LOG_FATAL, "Fill failed: %08X", addr);
+}
+
+int Target::TryFill (uint32_t addr, uint32_t value, uint8_t width, uint32_t cnt)
+{
+    if (!flexsoc_fill (addr, value, width, cnt))
+        return 0;
+    WriteDP (0, 0x1E);
+    return -1;
 }
 
 uint32_t Target::ReadReg (uint32_t addr)
@@ -168,6 +333,12 @@ void Target::WriteReg (uint32_t addr, uint32_t val)
     flexsoc_reg_write (addr, val);
 }
 
+void Target::Batch (flexsoc_op_t *op, int cnt)
+{
+    if (flexsoc_batch (op, cnt))
+        log (LOG_FATAL, "flexsoc_batch failed!");
+}
+
 
 // Access CSRs
 uint32_t Target::FlexsocID (void)
@@ -179,137 +350,208 @@ uint32_t Target::FlexsocID (void)
 
 uint32_t Target::Reset (bool pswitch)
 {
-    uint32_t val, idr;
+    uint32_t val = 0;
 
     log (LOG_TRACE, "RESET%s", pswitch ? "+PSWITCH" : "");
     // DP[0xc] is used as a pseudo register to allow
     // protocol specific RESET/PROTOCOL SWITCHING
-    WriteDP (0xc, 0);
+    QueueWriteDP (0xc, 0);
     if (pswitch)
-        WriteDP (0xc, 1);
+        QueueWriteDP (0xc, 1);
 
     // Must read IDR on reset
-    idr = this->ReadDP (0, &val);
-    log (LOG_TRACE, "IDR: %08X", idr);
+    QueueReadDP (0, &val);
+    QueueFlush ();
+    log (LOG_TRACE, "IDR: %08X", val);
     return val;
 }
 
-adiv5_stat_t Target::WriteDP (uint8_t addr, uint32_t data)
+void Target::Queue (uint8_t cmd, uint32_t data, uint32_t *rdata)
 {
-    uint32_t stat;
-
-    log (LOG_TRACE, "WriteDP(%02X): %08X", addr, data);
-  
-    // Write data
-    csr->adiv5_data (data);
-
-    // Write command
-    csr->adiv5_cmd (addr & 0xc);
-
-    // No response for RESET
-    if (addr != 0xc) {
-
-        // Wait until command completes
-        do {
-            stat = csr->adiv5_status ();
-        } while ((stat & 2) == 0);
-
-        return (adiv5_stat_t)(stat >> 2);
+    if (qcnt == qmax) {
+        qmax = qmax ? qmax * 2 : 16;
+        queue = (adiv5_op_t *)realloc (queue, qmax * sizeof (adiv5_op_t));
+        if (!queue)
+            log (LOG_FATAL, "Malloc failed!");
     }
+    queue[qcnt++] = {cmd, data, rdata};
+    dap_ops++;
+}
 
-    // For RESET return success
-    return ADIv5_OK;
-
+void Target::Invalidate (void)
+{
+    select_ok = false;
+    memset (cached, 0, sizeof (cached));
 }
 
-adiv5_stat_t Target::ReadDP (uint8_t addr, uint32_t *data)
+void Target::Select (uint8_t addr)
 {
-    uint32_t stat;
+    uint32_t sel = (ap << 24) | (addr & 0xF0);
 
-    log (LOG_TRACE, "ReadDP(%02X)", addr);
+    // Write DP[select] - apbank if changed
+    if (bridge || !select_ok || (select != sel))
+        QueueWriteDP (8, sel);
+}
+
+void Target::Track (uint8_t addr, uint32_t data, bool write)
+{
+    uint32_t next;
 
-    // Read command
-    csr->adiv5_cmd ((addr & 0xc) | 1);
+    switch (addr) {
 
-    // Wait until command completes
-    do {
-        stat = csr->adiv5_status ();
-    } while ((stat & 2) == 0);
+        // CSW/TAR written
+        case 0x00:
+            if (write) {
+                csw[ap] = data;
+                cached[ap] |= CACHE_CSW;
+            }
+            break;
+        case 0x04:
+            if (write) {
+                tar[ap] = data;
+                cached[ap] |= CACHE_TAR;
+            }
+            break;
 
-    // Check results
-    if ((adiv5_stat_t)(stat >> 2) != ADIv5_OK) {
-        log (LOG_TRACE, "=> %s", ADIv5_Stat ((adiv5_stat_t)(stat >> 2)));
-        return (adiv5_stat_t)(stat >> 2);
+        // DRW access - follow TAR auto-increment
+        case 0x0C:
+            if (!(cached[ap] & CACHE_CSW) || (CSW_ADDRINC (csw[ap]) > 1)) {
+                cached[ap] &= ~CACHE_TAR;
+                break;
+            }
+            if (CSW_ADDRINC (csw[ap]) == 1) {
+                next = tar[ap] + (1 << CSW_SIZE (csw[ap]));
+                if ((next & ~TAR_WRAP) != (tar[ap] & ~TAR_WRAP))
+                    cached[ap] &= ~CACHE_TAR;
+                tar[ap] = next;
+            }
+            break;
     }
-  
-    // Read data
-    *data = csr->adiv5_data ();
-    log (LOG_TRACE, "=> %08X", *data);
-  
-    // Return success
-    return ADIv5_OK;
 }
 
-adiv5_stat_t Target::WriteAP (uint8_t addr, uint32_t data)
+void Target::QueueWriteDP (uint8_t addr, uint32_t data)
 {
-    uint32_t stat;
-    adiv5_stat_t rv;
-  
-    log (LOG_TRACE, "WriteAP(%02X): %08X", addr, data);
-  
-    // Write DP[select] - apbank
-    rv = WriteDP (8, (ap << 24) | (addr & 0xF0));
-    if (rv != ADIv5_OK)
-        return rv;
+    log (LOG_TRACE, "WriteDP(%02X): %08X", addr, data);
+    Queue (addr & 0xc, data, NULL);
 
-    // Write data
-    csr->adiv5_data (data);
-  
-    // Wrte AP
-    csr->adiv5_cmd ((addr & 0xc) | 2);
+    // Track SELECT - RESET leaves everything unknown
+    if ((addr & 0xc) == 8) {
+        select = data;
+        select_ok = true;
+    }
+    else if ((addr & 0xc) == 0xc)
+        Invalidate ();
+}
 
-    // Wait until command completes
-    do {
-        stat = csr->adiv5_status ();
-    } while ((stat & 2) == 0);
+void Target::QueueReadDP (uint8_t addr, uint32_t *data)
+{
+    log (LOG_TRACE, "ReadDP(%02X)", addr);
+    Queue ((addr & 0xc) | 1, 0, data);
+}
 
-    if ((adiv5_stat_t)(stat >> 2) != ADIv5_OK)
-        log (LOG_TRACE, "=> %s", ADIv5_Stat ((adiv5_stat_t)(stat >> 2)));
+void Target::QueueWriteAP (uint8_t addr, uint32_t data)
+{
+    // Skip CSW/TAR already holding value
+    if (!bridge &&
+        (((addr == 0x00) && (cached[ap] & CACHE_CSW) && (csw[ap] == data)) ||
+         ((addr == 0x04) && (cached[ap] & CACHE_TAR) && (tar[ap] == data)))) {
+        log (LOG_TRACE, "WriteAP(%02X): %08X cached", addr, data);
+        return;
+    }
+    Select (addr);
+    log (LOG_TRACE, "WriteAP(%02X): %08X", addr, data);
+    Queue ((addr & 0xc) | 2, data, NULL);
+    Track (addr, data, true);
+}
 
-    // Return results
-    return (adiv5_stat_t)(stat >> 2);
+void Target::QueueReadAP (uint8_t addr, uint32_t *data)
+{
+    Select (addr);
+    log (LOG_TRACE, "ReadAP(%02X)", addr);
+    Queue ((addr & 0xc) | 3, 0, data);
+    Track (addr, 0, false);
 }
 
-adiv5_stat_t Target::ReadAP (uint8_t addr, uint32_t *data)
+adiv5_stat_t Target::QueueFlush (void)
 {
+    int i, n = 0;
     uint32_t stat;
-    adiv5_stat_t rv;
-  
-    log (LOG_TRACE, "ReadAP(%02X): ", addr);
+    adiv5_stat_t rv = ADIv5_OK;
+    flexsoc_op_t *op;
+
+    if (!qcnt)
+        return ADIv5_OK;
+    op = (flexsoc_op_t *)malloc (qcnt * 4 * sizeof (flexsoc_op_t));
+    if (!op)
+        log (LOG_FATAL, "Malloc failed!");
+
+    // Data, command, wait in gateware for done, read data
+    for (i = 0; i < qcnt; i++) {
+        if ((queue[i].cmd & 1) == 0)
+            op[n++] = {adiv5_data_addr, queue[i].data, true};
+        op[n++] = {adiv5_cmd_addr, queue[i].cmd, true};
+
+        // No response for RESET
+        if (queue[i].cmd == 0xc)
+            continue;
+        op[n++] = {adiv5_status_addr, 2, false, 2};
+        if (queue[i].cmd & 1)
+            op[n++] = {adiv5_data_addr, 0, false};
+    }
+    Batch (op, n);
+
+    // Collect status and read data
+    for (i = 0, n = 0; i < qcnt; i++) {
+        n += (queue[i].cmd & 1) ? 1 : 2;
+        if (queue[i].cmd == 0xc)
+            continue;
+        stat = op[n++].data;
+        if ((stat & 2) == 0)
+            stat = ADIv5_TIMEOUT << 2;
+        if ((adiv5_stat_t)(stat >> 2) != ADIv5_OK) {
+            log (LOG_TRACE, "=> %s", ADIv5_Stat ((adiv5_stat_t)(stat >> 2)));
+            if (rv == ADIv5_OK)
+                rv = (adiv5_stat_t)(stat >> 2);
+        }
+        if (queue[i].cmd & 1) {
+            if (((adiv5_stat_t)(stat >> 2) == ADIv5_OK) && queue[i].rdata) {
+                *queue[i].rdata = op[n].data;
+                log (LOG_TRACE, "=> %08X", op[n].data);
+            }
+            n++;
+        }
+    }
+    free (op);
 
-    // Write DP[select] - apbank
-    rv = WriteDP (8, (ap << 24) | (addr & 0xF0));
+    // Fault/timeout leaves DAP state unknown
     if (rv != ADIv5_OK)
-        return rv;
+        Invalidate ();
+    qcnt = 0;
+    return rv;
+}
 
-    // Wrte AP
-    csr->adiv5_cmd ((addr & 0xc) | 3);
+adiv5_stat_t Target::WriteDP (uint8_t addr, uint32_t data)
+{
+    QueueWriteDP (addr, data);
+    return QueueFlush ();
+}
 
-    // Wait until command completes
-    do {
-        stat = csr->adiv5_status ();
-    } while ((stat & 2) == 0);
+adiv5_stat_t Target::ReadDP (uint8_t addr, uint32_t *data)
+{
+    QueueReadDP (addr, data);
+    return QueueFlush ();
+}
 
-    // Check results
-    if ((adiv5_stat_t)(stat >> 2) != ADIv5_OK)
-        return (adiv5_stat_t)(stat >> 2);
-  
-    // Read data
-    *data = csr->adiv5_data ();
-    log (LOG_TRACE, "=> %08X", *data);
+adiv5_stat_t Target::WriteAP (uint8_t addr, uint32_t data)
+{
+    QueueWriteAP (addr, data);
+    return QueueFlush ();
+}
 
-    // Return success
-    return ADIv5_OK;
+adiv5_stat_t Target::ReadAP (uint8_t addr, uint32_t *data)
+{
+    QueueReadAP (addr, data);
+    return QueueFlush ();
 }
 
 const char *Target::ADIv5_Stat (adiv5_stat_t code)
@@ -326,6 +568,7 @@ const char *Target::ADIv5_Stat (adiv5_stat_t code)
 void Target::SetPhy (phy_t phy)
 {
     log (LOG_TRACE, "SETPHY: %s", phy == PHY_SWD ? "SWD" : "JTAG");
+    Invalidate ();
     switch (phy) {
         case PHY_SWD:
             csr->jtag_n_swd (0);
@@ -336,14 +579,188 @@ void Target::SetPhy (phy_t phy)
     }
 }
 
+static uint32_t div_hz (int div)
+{
+    return div ? PHY_CLK_HZ / (2 * div) : PHY_CLK_HZ;
+}
+
+void Target::SetDiv (uint8_t div)
+{
+    log (LOG_TRACE, "PHY_DIV: %d (%u Hz)", div, div_hz (div));
+    csr->phy_div (div);
+    phy_div = div;
+}
+
+uint32_t Target::SetClock (uint32_t hz)
+{
+    uint32_t div;
+
+    // Slowest rate not above hz
+    if (hz >= PHY_CLK_HZ)
+        div = 0;
+    else if (!hz)
+        div = PHY_DIV_MAX;
+    else {
+        div = (PHY_CLK_HZ + (2 * hz) - 1) / (2 * hz);
+        div = div > PHY_DIV_MAX ? PHY_DIV_MAX : div;
+    }
+    SetDiv (div);
+    return Clock ();
+}
+
+uint32_t Target::Clock (void)
+{
+    return div_hz (phy_div);
+}
+
+bool Target::ClockCheck (uint32_t idr, uint32_t addr)
+{
+    int i;
+    uint32_t val = 0, rd[CLK_CHECK_WORDS];
+
+    // Line reset then DPIDR
+    QueueWriteDP (0xc, 0);
+    QueueReadDP (0, &val);
+
+    // Block write then read back in same stream
+    QueueWriteAP (0, CSW_BLOCK);
+    QueueWriteAP (4, addr);
+    for (i = 0; i < CLK_CHECK_WORDS; i++)
+        QueueWriteAP (0xC, clk_pattern[i]);
+    QueueWriteAP (4, addr);
+    memset (rd, 0, sizeof (rd));
+    for (i = 0; i < CLK_CHECK_WORDS; i++)
+        QueueReadAP (0xC, &rd[i]);
+    if ((QueueFlush () != ADIv5_OK) || (val != idr))
+        return false;
+    return !memcmp (rd, clk_pattern, sizeof (rd));
+}
+
+uint32_t Target::NegotiateClock (uint32_t addr, uint32_t max)
+{
+    int i, div, best = -1;
+    uint32_t idr = 0, save[CLK_CHECK_WORDS];
+    bool was_bridge = bridge;
+
+    // Checks drive MEM-AP directly
+    if (was_bridge)
+        BridgeEn (false);
+
+    // Reference IDR and memory at slowest clock
+    SetDiv (PHY_DIV_MAX);
+    Reset (false);
+    if ((ReadDP (0, &idr) != ADIv5_OK) || EnableAP (true)) {
+        log (LOG_ERR, "No response at %u Hz", Clock ());
+        if (was_bridge)
+            BridgeEn (true);
+        return 0;
+    }
+    if (MemAP (addr, save, CLK_CHECK_WORDS, false) != ADIv5_OK)
+        log (LOG_FATAL, "MEM-AP read failed: %08X", addr);
+
+    // Step up until a check fails
+    for (div = PHY_DIV_MAX; div_hz (div) <= max; div = (div == 1) ? 0 : (div + 1) / 2) {
+        SetDiv (div);
+        for (i = 0; i < CLK_CHECK_PASS; i++)
+            if (!ClockCheck (idr, addr))
+                break;
+        if (i < CLK_CHECK_PASS)
+            break;
+        best = div;
+        if (!div)
+            break;
+    }
+
+    if (best < 0) {
+        log (LOG_ERR, "Read-back failed at %u Hz", Clock ());
+        SetDiv (PHY_DIV_MAX);
+        if (was_bridge)
+            BridgeEn (true);
+        return 0;
+    }
+
+    // Recover link at best rate - failed step may leave sticky errors
+    SetDiv (best);
+    Reset (false);
+    WriteDP (0, 0x1E);
+    if (MemAP (addr, save, CLK_CHECK_WORDS, true) != ADIv5_OK)
+        log (LOG_FATAL, "MEM-AP write failed: %08X", addr);
+    if (was_bridge)
+        BridgeEn (true);
+
+    log (LOG_DEBUG, "Clock negotiated: %u Hz", Clock ());
+    return Clock ();
+}
+
+void Target::SetRetry (uint8_t cnt)
+{
+    // Mode may only change with nothing outstanding
+    QueueFlush ();
+    log (LOG_TRACE, "RETRY: %d", cnt);
+    csr->adiv5_retry (cnt);
+    retry = cnt;
+}
+
+uint8_t Target::Retry (void)
+{
+    return csr->adiv5_retry ();
+}
+
+uint32_t Target::WaitCount (void)
+{
+    return csr->adiv5_waits ();
+}
+
 void Target::BridgeAPSel (uint8_t ap)
 {
     csr->apsel (ap);
+    Invalidate ();
+}
+
+int Target::BridgeWindow (int idx, uint32_t base, uint32_t size, uint8_t ap, uint32_t remap)
+{
+    uint32_t mask = size - 1;
+
+    // Must stay below CSRs and be naturally aligned
+    if ((idx < 0) || (idx >= BRIDGE_WINDOWS) || !size || (size & mask) ||
+        (base & mask) || (remap & mask) || (base + mask >= CSR_BASE) ||
+        (base + mask < base))
+        return -1;
+    log (LOG_TRACE, "WINDOW%d: %08X-%08X => AP%d %08X", idx, base, base + mask, ap, remap);
+
+    // Disable while changing
+    BridgeWindowDisable (idx);
+    switch (idx) {
+        case 0:
+            csr->win0_base (base);
+            csr->win0_mask (mask);
+            csr->win0_remap (remap);
+            csr->win0_ap (0x100 | ap);
+            break;
+        case 1:
+            csr->win1_base (base);
+            csr->win1_mask (mask);
+            csr->win1_remap (remap);
+            csr->win1_ap (0x100 | ap);
+            break;
+    }
+    return 0;
+}
+
+void Target::BridgeWindowDisable (int idx)
+{
+    switch (idx) {
+        case 0: csr->win0_ap (0); break;
+        case 1: csr->win1_ap (0); break;
+    }
 }
 
 void Target::BridgeEn (bool enabled)
 {
+    // Bridge rewrites SELECT/CSW/TAR behind our back
     csr->bridge_en (enabled);
+    bridge = enabled;
+    Invalidate ();
 }
 
 void Target::BridgeMode (brg_mode_t mode)
@@ -368,6 +785,16 @@ void Target::BridgeIRQBuf (uint32_t addr)
     csr->irq_base (addr);
 }
 
+void Target::BridgeHaltWatch (bool enabled)
+{
+    csr->halt_watch (enabled);
+}
+
+uint32_t Target::BridgeIRQCount (void)
+{
+    return csr->irq_cnt ();
+}
+
 void Target::RegisterIRQHandler (irq_handler_t handler)
 {
     cb = handler;
@@ -376,8 +803,22 @@ void Target::RegisterIRQHandler (irq_handler_t handler)
 
 void Target::UnregisterIRQHandler (void)
 {
-    flexsoc_unregister ();
     cb = NULL;
+    if (!halt_cb)
+        flexsoc_unregister ();
+}
+
+void Target::RegisterHaltHandler (halt_handler_t handler)
+{
+    halt_cb = handler;
+    flexsoc_register (&flexsoc_irq_convert);
+}
+
+void Target::UnregisterHaltHandler (void)
+{
+    halt_cb = NULL;
+    if (!cb)
+        flexsoc_unregister ();
 }
 
 void Target::IRQAck (uint8_t cmd)
@@ -13,6 +13,7 @@
 #include <stdlib.h>
 
 #include "flexdbg_csr.h"
+#include "flexsoc.h"
 
 
 // ADIv5 status
@@ -36,9 +37,25 @@ typedef enum {
   MODE_SEQUENTIAL = 1
 } brg_mode_t;
 
+// AP windows in bridge
+#define BRIDGE_WINDOWS 2
+
+// PHY clock divider range - 0 is undivided PHY_CLK
+#define PHY_DIV_MAX    255
+
 // IRQ handler type
 typedef void (*irq_handler_t) (uint8_t ctl, uint8_t irq);
 
+// Halt watch handler type - DHCSR when halt/lockup/reset changed
+typedef void (*halt_handler_t) (uint32_t dhcsr);
+
+// Queued ADIv5 operation
+typedef struct {
+  uint8_t cmd;        // A[3:2] | APnDP | RnW
+  uint32_t data;
+  uint32_t *rdata;    // Read result
+} adiv5_op_t;
+
 class Target {
 
   static Target *inst;
@@ -49,6 +66,31 @@ private:
   bool ap_enabled = false;
   int timeout = 20;
   uint8_t ap = 0;
+
+  // ADIv5 CSR addresses for queued operations
+  uint32_t adiv5_cmd_addr, adiv5_data_addr, adiv5_status_addr;
+  uint8_t phy_div;
+  uint8_t retry = 0;
+
+  // ADIv5 queue - executed as one command stream
+  adiv5_op_t *queue = NULL;
+  int qcnt = 0, qmax = 0;
+  void Queue (uint8_t cmd, uint32_t data, uint32_t *rdata);
+
+  // Cached DAP state - skips redundant SELECT/CSW/TAR writes.
+  // Not used while the bridge owns the AP.
+  uint32_t select;
+  bool select_ok = false;
+  uint32_t csw[256], tar[256];
+  uint8_t cached[256];
+  bool bridge = false;
+  uint64_t dap_ops = 0;
+  void Invalidate (void);
+  void Select (uint8_t addr);
+  void Track (uint8_t addr, uint32_t data, bool write);
+  adiv5_stat_t MemAP (uint32_t addr, uint32_t *data, uint32_t cnt, bool write);
+  void SetDiv (uint8_t div);
+  bool ClockCheck (uint32_t idr, uint32_t addr);
   
  public:
 
@@ -71,25 +113,57 @@ private:
   // Set 8bit AP (typically MEM-AP is 0)
   void SetAP (uint8_t ap) { this->ap = ap; }
   
-  // General APIs
+  // General APIs - ReadW/WriteW use MEM-AP directly when bridge disabled
   void ReadW (uint32_t addr, uint32_t *data, uint32_t cnt);
   void ReadH (uint32_t addr, uint16_t *data, uint32_t cnt);
   void ReadB (uint32_t addr, uint8_t *data, uint32_t cnt);
+  void ReadWFixed (uint32_t addr, uint32_t *data, uint32_t cnt);
+
+  // As ReadW/ReadB but bus faults return non-zero instead of exiting
+  int TryReadW (uint32_t addr, uint32_t *data, uint32_t cnt);
+  int TryReadB (uint32_t addr, uint8_t *data, uint32_t cnt);
+
   void WriteW (uint32_t addr, const uint32_t *data, uint32_t cnt);
   void WriteH (uint32_t addr, const uint16_t *data, uint32_t cnt);
   void WriteB (uint32_t addr, const uint8_t *data, uint32_t cnt);
+  void Fill (uint32_t addr, uint32_t value, uint8_t width, uint32_t cnt);
+
+  // As WriteW/WriteB/Fill but bus faults return non-zero instead of exiting
+  int TryWriteW (uint32_t addr, const uint32_t *data, uint32_t cnt);
+  int TryWriteB (uint32_t addr, const uint8_t *data, uint32_t cnt);
+  int TryFill (uint32_t addr, uint32_t value, uint8_t width, uint32_t cnt);
   uint32_t ReadReg (uint32_t addr);
   void WriteReg (uint32_t addr, uint32_t val);
 
+  // Issue word reads/writes back to back in a single stream
+  void Batch (flexsoc_op_t *op, int cnt);
+
   // Switch modes
   void SetPhy (phy_t phy);
 
+  // PHY clock - rounds down to nearest divider, returns actual Hz.
+  // Only change while idle then reset the link.
+  uint32_t SetClock (uint32_t hz);
+  uint32_t Clock (void);
+
+  // Step clock up to max Hz checking DPIDR and MEM-AP read-back of a
+  // few words at addr (restored after). Fastest rate passing is kept.
+  // Returns Hz or 0.
+  uint32_t NegotiateClock (uint32_t addr, uint32_t max);
+
   // Bridge functions
   void BridgeEn (bool enabled);
   void BridgeAPSel (uint8_t ap);
   void BridgeMode (brg_mode_t mode);
   void BridgeIRQScanEn (bool enabled);
   void BridgeIRQBuf (uint32_t addr);
+  void BridgeHaltWatch (bool enabled);
+  uint32_t BridgeIRQCount (void);
+
+  // Map host [base, base+size) to target remap.. on ap - size power of two,
+  // base/remap size aligned. Accesses outside windows use BridgeAPSel.
+  int BridgeWindow (int idx, uint32_t base, uint32_t size, uint8_t ap, uint32_t remap);
+  void BridgeWindowDisable (int idx);
   
   // Read/Write ADIv5
   adiv5_stat_t WriteDP (uint8_t addr, uint32_t data);
@@ -98,6 +172,27 @@ private:
   adiv5_stat_t ReadAP (uint8_t addr, uint32_t *data);
   uint32_t Reset (bool pswitch);
   const char *ADIv5_Stat (adiv5_stat_t code);
+
+  // Queue ADIv5 operations - statuses and read data collected in a
+  // single pass by QueueFlush, which returns the first failure
+  void QueueWriteDP (uint8_t addr, uint32_t data);
+  void QueueReadDP (uint8_t addr, uint32_t *data);
+  void QueueWriteAP (uint8_t addr, uint32_t data);
+  void QueueReadAP (uint8_t addr, uint32_t *data);
+  adiv5_stat_t QueueFlush (void);
+
+  // DP/AP operations issued - measures cache savings
+  uint64_t ADIv5Ops (void) { return dap_ops; }
+
+  // Retry WAIT responses in gateware up to cnt times - 0 returns WAIT
+  // as ADIv5_TIMEOUT. Non-zero keeps one operation outstanding, so set
+  // 0 for pipelined bridge bursts on targets that never WAIT. Queued
+  // operations are flushed first. Defaults to 8 at connect.
+  void SetRetry (uint8_t cnt);
+  uint8_t Retry (void);
+
+  // WAIT responses seen by gateware
+  uint32_t WaitCount (void);
   
   // Access ID/version
   uint32_t FlexsocID (void);
@@ -106,6 +201,10 @@ private:
   void RegisterIRQHandler (irq_handler_t);
   void UnregisterIRQHandler (void);
 
+  // Async halt/lockup/reset notification from gateware DHCSR watch
+  void RegisterHaltHandler (halt_handler_t);
+  void UnregisterHaltHandler (void);
+
   // Acknowledge IRQ
   void IRQAck (uint8_t cmd);
 };
@@ -0,0 +1,20 @@
+unsigned char armv7m_crc32_bin[] = {
+  0x00, 0xbe, 0x00, 0xbf, 0x00, 0xf0, 0x02, 0xb8, 0x00, 0xf0, 0x19, 0xb8,
+  0x6f, 0xea, 0x02, 0x02, 0x1c, 0xa3, 0x89, 0xb1, 0x10, 0xf8, 0x01, 0xcb,
+  0x82, 0xea, 0x0c, 0x02, 0x02, 0xf0, 0x0f, 0x0c, 0x53, 0xf8, 0x2c, 0xc0,
+  0x8c, 0xea, 0x12, 0x12, 0x02, 0xf0, 0x0f, 0x0c, 0x53, 0xf8, 0x2c, 0xc0,
+  0x8c, 0xea, 0x12, 0x12, 0x49, 0x1e, 0xed, 0xd1, 0x6f, 0xea, 0x02, 0x00,
+  0x70, 0x47, 0x11, 0xa4, 0xf1, 0xb1, 0x91, 0x42, 0x34, 0xbf, 0x0d, 0x46,
+  0x15, 0x46, 0xa1, 0xeb, 0x05, 0x01, 0x6f, 0xf0, 0x00, 0x06, 0x10, 0xf8,
+  0x01, 0x7b, 0x86, 0xea, 0x07, 0x06, 0x06, 0xf0, 0x0f, 0x07, 0x54, 0xf8,
+  0x27, 0x70, 0x87, 0xea, 0x16, 0x16, 0x06, 0xf0, 0x0f, 0x07, 0x54, 0xf8,
+  0x27, 0x70, 0x87, 0xea, 0x16, 0x16, 0x6d, 0x1e, 0xed, 0xd1, 0x6f, 0xea,
+  0x06, 0x06, 0x43, 0xf8, 0x04, 0x6b, 0xdf, 0xe7, 0x00, 0x20, 0xbd, 0xe7,
+  0x00, 0x00, 0x00, 0x00, 0x64, 0x10, 0xb7, 0x1d, 0xc8, 0x20, 0x6e, 0x3b,
+  0xac, 0x30, 0xd9, 0x26, 0x90, 0x41, 0xdc, 0x76, 0xf4, 0x51, 0x6b, 0x6b,
+  0x58, 0x61, 0xb2, 0x4d, 0x3c, 0x71, 0x05, 0x50, 0x20, 0x83, 0xb8, 0xed,
+  0x44, 0x93, 0x0f, 0xf0, 0xe8, 0xa3, 0xd6, 0xd6, 0x8c, 0xb3, 0x61, 0xcb,
+  0xb0, 0xc2, 0x64, 0x9b, 0xd4, 0xd2, 0xd3, 0x86, 0x78, 0xe2, 0x0a, 0xa0,
+  0x1c, 0xf2, 0xbd, 0xbd
+};
+unsigned int armv7m_crc32_bin_len = 196;
@@ -9,8 +9,13 @@
 #ifndef HWREG_H
 #define HWREG_H
 
-// Must be updated if HDL map changes
-#define CSR_BASE 0xF0000000
+#include "flexsoc.h"
+
+// CSR block base - owned by flexsoc transport
+#define CSR_BASE FLEXSOC_CSR_BASE
+
+// PHY_CLK feeding flexsoc_debug divider
+#define PHY_CLK_HZ 200000000
 
 #endif /* HWREG_H */
 
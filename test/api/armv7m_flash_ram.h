@@ -0,0 +1,9 @@
+unsigned char armv7m_flash_ram_bin[] = {
+  0x00, 0xbe, 0x00, 0xbf, 0x00, 0xf0, 0x06, 0xb8, 0x00, 0xf0, 0x04, 0xb8,
+  0x00, 0xf0, 0x04, 0xb8, 0x00, 0xf0, 0x0c, 0xb8, 0x00, 0x20, 0x70, 0x47,
+  0x4f, 0xf0, 0xff, 0x31, 0x40, 0xf2, 0x00, 0x12, 0x40, 0xf8, 0x04, 0x1b,
+  0x52, 0x1e, 0xfb, 0xd1, 0x00, 0x20, 0x70, 0x47, 0xc9, 0x1c, 0x89, 0x08,
+  0x05, 0xd0, 0x52, 0xf8, 0x04, 0x3b, 0x40, 0xf8, 0x04, 0x3b, 0x49, 0x1e,
+  0xf9, 0xd1, 0x00, 0x20, 0x70, 0x47, 0x00, 0xbf
+};
+unsigned int armv7m_flash_ram_bin_len = 68;
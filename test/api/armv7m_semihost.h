@@ -0,0 +1,11 @@
+unsigned char armv7m_semihost_bin[] = {
+  0x00, 0xbe, 0x00, 0xbf, 0x00, 0xf0, 0x00, 0xb8, 0x04, 0x46, 0x04, 0x20,
+  0x04, 0xa1, 0xab, 0xbe, 0x01, 0x3c, 0xfa, 0xd1, 0x18, 0x20, 0x01, 0x49,
+  0xab, 0xbe, 0xf1, 0xe7, 0x26, 0x00, 0x02, 0x00, 0x66, 0x6c, 0x65, 0x78,
+  0x73, 0x6f, 0x63, 0x20, 0x73, 0x65, 0x6d, 0x69, 0x68, 0x6f, 0x73, 0x74,
+  0x69, 0x6e, 0x67, 0x20, 0x63, 0x6f, 0x6e, 0x73, 0x6f, 0x6c, 0x65, 0x20,
+  0x62, 0x65, 0x6e, 0x63, 0x68, 0x6d, 0x61, 0x72, 0x6b, 0x20, 0x30, 0x31,
+  0x32, 0x33, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x61, 0x62, 0x63, 0x64,
+  0x65, 0x66, 0x0a, 0x00
+};
+unsigned int armv7m_semihost_bin_len = 88;
@@ -0,0 +1,80 @@
+/**
+ *  flexsoc-debug test
+ *
+ *  SELECT/CSW/TAR cache skips redundant DAP writes
+ *
+ *  Tiny Labs Inc
+ *  2022
+ */
+
+#include <cassert>
+#include <unistd.h>
+#include "Target.h"
+#include "log.h"
+
+int main (int argc, char **argv)
+{
+  uint64_t ops;
+  uint32_t val = 0;
+
+  // Connect to target
+  Target *target = Target::Ptr (argv[1]);
+  assert (target != NULL);
+
+  // Validate CRC of CSR
+  assert (target->Validate () == 0);
+
+  // Set phy to SWD
+  target->SetPhy (PHY_SWD);
+
+  // Send reset + protocol switch
+  target->Reset (1);
+
+  // Enable AP access
+  assert (target->EnableAP (true) == 0);
+
+  // Same bank - no SELECT
+  assert (target->ReadAP (0xfc, &val) == ADIv5_OK);
+  ops = target->ADIv5Ops ();
+  assert (target->ReadAP (0xf8, &val) == ADIv5_OK);
+  assert (target->ADIv5Ops () == ops + 1);
+
+  // Bank change writes SELECT
+  ops = target->ADIv5Ops ();
+  assert (target->WriteAP (0, 0xA3000012) == ADIv5_OK);
+  assert (target->ADIv5Ops () == ops + 2);
+
+  // Rewriting CSW is free
+  ops = target->ADIv5Ops ();
+  assert (target->WriteAP (0, 0xA3000012) == ADIv5_OK);
+  assert (target->ADIv5Ops () == ops);
+
+  // Word auto-increment tracked in TAR
+  assert (target->WriteAP (4, 0x20000000) == ADIv5_OK);
+  assert (target->WriteAP (0xc, 0x11223344) == ADIv5_OK);
+  ops = target->ADIv5Ops ();
+  assert (target->WriteAP (4, 0x20000004) == ADIv5_OK);
+  assert (target->ADIv5Ops () == ops);
+  assert (target->WriteAP (0xc, 0x55667788) == ADIv5_OK);
+
+  // Read back through banked registers without increment
+  assert (target->WriteAP (0, 0xA3000002) == ADIv5_OK);
+  assert (target->WriteAP (4, 0x20000000) == ADIv5_OK);
+  assert (target->ReadAP (0x10, &val) == ADIv5_OK);
+  assert (val == 0x11223344);
+  assert (target->ReadAP (0x14, &val) == ADIv5_OK);
+  assert (val == 0x55667788);
+
+  // Reset invalidates TAR - EnableAP already restored SELECT
+  target->Reset (0);
+  assert (target->EnableAP (true) == 0);
+  ops = target->ADIv5Ops ();
+  assert (target->WriteAP (4, 0x20000000) == ADIv5_OK);
+  assert (target->ADIv5Ops () == ops + 1);
+
+  // Close device
+  delete target;
+  
+  // Success
+  return 0;
+}
@@ -0,0 +1,64 @@
+/**
+ *  flexsoc-debug test
+ *
+ *  Queued ADIv5 operations in a single command stream
+ *
+ *  Tiny Labs Inc
+ *  2022
+ */
+
+#include <cassert>
+#include <unistd.h>
+#include "Target.h"
+#include "log.h"
+
+int main (int argc, char **argv)
+{
+  uint32_t idr = 0, ctrl = 0, apidr = 0, csw = 0, bd0 = 0;
+
+  // Connect to target
+  Target *target = Target::Ptr (argv[1]);
+  assert (target != NULL);
+
+  // Validate CRC of CSR
+  assert (target->Validate () == 0);
+
+  // Set phy to SWD
+  target->SetPhy (PHY_SWD);
+
+  // Reset, protocol switch and IDR read in one pass
+  assert (target->Reset (1) == 0x2BA01477);
+
+  // Power up and read back
+  target->QueueReadDP (0, &idr);
+  target->QueueWriteDP (4, 0x50000000);
+  target->QueueReadDP (4, &ctrl);
+  assert (target->QueueFlush () == ADIv5_OK);
+  assert (idr == 0x2BA01477);
+  assert (target->EnableAP (true) == 0);
+
+  // AP accesses across banks - SELECT only written on bank change
+  target->QueueReadAP (0xfc, &apidr);
+  target->QueueWriteAP (4, 0x20000000);
+  target->QueueWriteAP (0, 0xA3000002);
+  target->QueueWriteAP (0xc, 0x11223344);
+  target->QueueReadAP (0x10, &bd0);
+  target->QueueReadAP (0x00, &csw);
+  assert (target->QueueFlush () == ADIv5_OK);
+  assert (apidr == 0x24770011);
+  assert (bd0 == 0x11223344);
+  assert (csw == 0x23000042);
+
+  // Empty queue
+  assert (target->QueueFlush () == ADIv5_OK);
+
+  // Single operations still work
+  assert (target->ReadAP (0xfc, &apidr) == ADIv5_OK);
+  assert (apidr == 0x24770011);
+
+  // Close device
+  delete target;
+  
+  // Success
+  return 0;
+}
@@ -0,0 +1,69 @@
+/**
+ *  flexsoc-debug test
+ *
+ *  ADIv5 WAIT retried in gateware
+ *
+ *  Tiny Labs Inc
+ *  2022
+ */
+
+#include <cassert>
+#include <stdio.h>
+#include "Target.h"
+#include "log.h"
+
+#define SCRATCH  0x20000000
+#define WORDS    256
+
+int main (int argc, char **argv)
+{
+  int i;
+  uint32_t waits, idr = 0;
+  uint32_t wr[WORDS], rd[WORDS];
+
+  // Connect to target
+  Target *target = Target::Ptr (argv[1]);
+  assert (target != NULL);
+
+  // Validate CRC of CSR
+  assert (target->Validate () == 0);
+
+  // Set phy to SWD
+  target->SetPhy (PHY_SWD);
+
+  // Retry on by default, limit readback
+  assert (target->Retry () != 0);
+  target->SetRetry (32);
+  assert (target->Retry () == 32);
+
+  // Link works with retries enabled
+  assert (target->Reset (1) == 0x2BA01477);
+  assert (target->EnableAP (true) == 0);
+  waits = target->WaitCount ();
+
+  // Queued MEM-AP block through retry
+  for (i = 0; i < WORDS; i++)
+    wr[i] = 0x5A000000 | i;
+  target->WriteW (SCRATCH, wr, WORDS);
+  target->ReadW (SCRATCH, rd, WORDS);
+  for (i = 0; i < WORDS; i++)
+    assert (rd[i] == wr[i]);
+  printf ("WAITs: %u\n", target->WaitCount () - waits);
+
+  // Bridge still pipelines with retry disabled
+  target->SetRetry (0);
+  target->BridgeAPSel (0);
+  target->BridgeEn (true);
+  target->ReadW (SCRATCH, rd, WORDS);
+  for (i = 0; i < WORDS; i++)
+    assert (rd[i] == wr[i]);
+  target->BridgeEn (false);
+  assert (target->ReadDP (0, &idr) == ADIv5_OK);
+  assert (idr == 0x2BA01477);
+
+  // Close device
+  delete target;
+  
+  // Success
+  return 0;
+}
@@ -0,0 +1,123 @@
+/**
+ *  flexsoc-debug test
+ *
+ *  Bridge AP windows mixed in one batch and interleaved across APs
+ *
+ *  Tiny Labs Inc
+ *  2022
+ */
+
+#include <cassert>
+#include <unistd.h>
+#include "Target.h"
+#include "log.h"
+
+// Host alias of target RAM through window
+#define WIN_BASE  0x80000000
+#define WIN_SIZE  0x10000
+#define RAM_ADDR  0x20000000
+
+// Second window - SCS on AP0, then AP not present in sim
+#define WIN1_BASE 0x90000000
+#define SCS_BASE  0xE000E000
+#define SCS_SIZE  0x1000
+#define CPUID     0xE000ED00
+#define NO_AP     1
+
+int main (int argc, char **argv)
+{
+  int i, rv;
+  uint32_t val = 0, idr = 0, cpuid = 0;
+  flexsoc_op_t op[8];
+
+  // Connect to target
+  Target *target = Target::Ptr (argv[1]);
+  assert (target != NULL);
+
+  // Validate CRC of CSR
+  assert (target->Validate () == 0);
+
+  // Set phy to SWD
+  target->SetPhy (PHY_SWD);
+
+  // Send reset + protocol switch
+  target->Reset (1);
+
+  // Enable AP access
+  assert (target->EnableAP (true) == 0);
+
+  // No AP behind second window (IDR zero or fault)
+  target->SetAP (NO_AP);
+  assert ((target->ReadAP (0xFC, &idr) != ADIv5_OK) || (idr == 0));
+  target->SetAP (0);
+  assert ((target->ReadAP (0xFC, &idr) == ADIv5_OK) && (idr != 0));
+
+  // Enable bridge
+  target->BridgeAPSel (0);
+  target->BridgeEn (true);
+
+  // Bad geometry rejected
+  assert (target->BridgeWindow (0, WIN_BASE, 0x3000, 0, RAM_ADDR) != 0);
+  assert (target->BridgeWindow (0, WIN_BASE + 0x100, WIN_SIZE, 0, RAM_ADDR) != 0);
+  assert (target->BridgeWindow (BRIDGE_WINDOWS, WIN_BASE, WIN_SIZE, 0, RAM_ADDR) != 0);
+  assert (target->BridgeWindow (0, 0xF0000000, WIN_SIZE, 0, RAM_ADDR) != 0);
+
+  // Map alias of RAM on AP0
+  assert (target->BridgeWindow (0, WIN_BASE, WIN_SIZE, 0, RAM_ADDR) == 0);
+
+  // Write through window, read direct
+  val = 0xDEADBEEF;
+  target->WriteW (WIN_BASE + 0x10, &val, 1);
+  val = 0;
+  target->ReadW (RAM_ADDR + 0x10, &val, 1);
+  assert (val == 0xDEADBEEF);
+
+  // Mix windowed and default accesses in one batch
+  op[0] = {RAM_ADDR + 0x20, 0x11223344, true};
+  op[1] = {WIN_BASE + 0x24, 0x55667788, true};
+  op[2] = {WIN_BASE + 0x20, 0, false};
+  op[3] = {RAM_ADDR + 0x24, 0, false};
+  target->Batch (op, 4);
+  assert (op[2].data == 0x11223344);
+  assert (op[3].data == 0x55667788);
+
+  // Interleave RAM and SCS windows - a stale TAR returns the wrong word
+  target->ReadW (CPUID, &cpuid, 1);
+  assert ((cpuid >> 24) == 0x41);
+  assert (target->BridgeWindow (1, WIN1_BASE, SCS_SIZE, 0, SCS_BASE) == 0);
+  for (i = 0; i < 8; i += 2) {
+    op[i] = {WIN_BASE + 0x20 + ((i & 2) * 2), 0, false};
+    op[i + 1] = {WIN1_BASE + (CPUID - SCS_BASE), 0, false};
+  }
+  target->Batch (op, 8);
+  for (i = 0; i < 8; i += 2) {
+    assert (op[i].data == ((i & 2) ? 0x55667788 : 0x11223344));
+    assert (op[i + 1].data == cpuid);
+  }
+
+  // Same RAM through window on absent AP - reads as zero or faults,
+  // never the AP0 word, however often the bridge switches APs
+  assert (target->BridgeWindow (1, WIN1_BASE, WIN_SIZE, NO_AP, RAM_ADDR) == 0);
+  for (i = 0; i < 4; i++) {
+    val = 0xFFFFFFFF;
+    rv = target->TryReadW (WIN1_BASE + 0x10, &val, 1);
+    assert (rv || (val == 0));
+
+    // AP0 window still routed after access to other AP
+    val = 0;
+    target->ReadW (WIN_BASE + 0x10, &val, 1);
+    assert (val == 0xDEADBEEF);
+  }
+  target->BridgeWindowDisable (1);
+
+  // Default AP unaffected once window removed
+  target->BridgeWindowDisable (0);
+  target->ReadW (RAM_ADDR + 0x20, &val, 1);
+  assert (val == 0x11223344);
+
+  // Close device
+  delete target;
+  
+  // Success
+  return 0;
+}
@@ -0,0 +1,63 @@
+/**
+ *  flexsoc-debug test
+ *
+ *  PHY clock divider and maximum clock negotiation
+ *
+ *  Tiny Labs Inc
+ *  2022
+ */
+
+#include <cassert>
+#include <stdio.h>
+#include "Target.h"
+#include "hwreg.h"
+#include "log.h"
+
+#define SCRATCH  0x20000000
+
+int main (int argc, char **argv)
+{
+  uint32_t hz, idr = 0, val = 0x11223344, rd = 0;
+
+  // Connect to target
+  Target *target = Target::Ptr (argv[1]);
+  assert (target != NULL);
+
+  // Validate CRC of CSR
+  assert (target->Validate () == 0);
+
+  // Set phy to SWD
+  target->SetPhy (PHY_SWD);
+
+  // Rates round down to divider
+  assert (target->SetClock (PHY_CLK_HZ) == PHY_CLK_HZ);
+  assert (target->SetClock (PHY_CLK_HZ / 2) == PHY_CLK_HZ / 2);
+  assert (target->SetClock (PHY_CLK_HZ / 3) == PHY_CLK_HZ / 4);
+  assert (target->SetClock (1) == PHY_CLK_HZ / (2 * PHY_DIV_MAX));
+
+  // Link works at slowest clock
+  assert (target->Reset (1) == 0x2BA01477);
+  assert (target->EnableAP (true) == 0);
+
+  // Negotiate - scratch contents preserved
+  target->WriteW (SCRATCH, &val, 1);
+  hz = target->NegotiateClock (SCRATCH, PHY_CLK_HZ);
+  assert (hz != 0);
+  assert (target->Clock () == hz);
+  printf ("Negotiated: %u Hz\n", hz);
+  target->ReadW (SCRATCH, &rd, 1);
+  assert (rd == val);
+
+  // Limit respected
+  assert (target->NegotiateClock (SCRATCH, PHY_CLK_HZ / 8) <= PHY_CLK_HZ / 8);
+
+  // Link still good at negotiated rate
+  assert (target->ReadDP (0, &idr) == ADIv5_OK);
+  assert (idr == 0x2BA01477);
+
+  // Close device
+  delete target;
+  
+  // Success
+  return 0;
+}
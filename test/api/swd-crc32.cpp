@@ -0,0 +1,78 @@
+/**
+ *  flexsoc-debug test
+ *
+ *  Tiny Labs Inc
+ *  2022
+ */
+
+#include <cassert>
+#include <unistd.h>
+#include <stdlib.h>
+#include <time.h>
+#include "Target.h"
+#include "Debug.h"
+#include "log.h"
+
+// Image buffer
+static uint32_t data[1024];
+
+int main (int argc, char **argv)
+{
+  uint32_t i, crc;
+  Debug *debug;
+  
+  // Connect to target
+  Target *target = Target::Ptr (argv[1]);
+  assert (target != NULL);
+
+  // Validate CRC of CSR
+  assert (target->Validate () == 0);
+
+  // Set phy to SWD
+  target->SetPhy (PHY_SWD);
+
+  // Send reset + protocol switch
+  target->Reset (1);
+
+  // Enable AP access
+  assert (target->EnableAP (true) == 0);
+
+  // Enable bridge
+  target->BridgeAPSel (0);
+  target->BridgeEn (true);
+
+  // Create debug interface
+  debug = new Debug (target);
+
+  // Reset and halt target
+  assert (debug->Halt (true) == SUCCESS);
+
+  // Run stubs above image
+  debug->SetScratch (0x20001800);
+  
+  // Load random image
+  srand (time (NULL));
+  for (i = 0; i < sizeof (data) / sizeof (uint32_t); i++)
+    data[i] = rand ();
+  target->BridgeMode (MODE_SEQUENTIAL);
+  target->WriteW (0x20000000, data, sizeof (data) / sizeof (uint32_t));
+
+  // Known CRC32 vector
+  target->WriteB (0x20001000, (const uint8_t *)"123456789", 9);
+  assert (debug->Crc32 (0x20001000, 9, &crc) == SUCCESS);
+  assert (crc == 0xCBF43926);
+  
+  // Verify image
+  assert (debug->VerifyImage (0x20000000, (uint8_t *)data, sizeof (data)) == SUCCESS);
+
+  // Corrupt image and make sure we catch it
+  data[100] ^= 1;
+  assert (debug->VerifyImage (0x20000000, (uint8_t *)data, sizeof (data)) == -ERR_VERIFY);
+
+  // Clean up
+  delete debug;
+  delete target;
+  
+  // Success
+  return 0;
+}
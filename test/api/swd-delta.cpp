@@ -0,0 +1,96 @@
+/**
+ *  flexsoc-debug test
+ *
+ *  Delta load only rewrites changed pages
+ *
+ *  Tiny Labs Inc
+ *  2022
+ */
+
+#include <cassert>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "Target.h"
+#include "Debug.h"
+#include "log.h"
+
+// Image buffer
+static uint32_t data[1024];
+
+static void write_image (const char *name)
+{
+  FILE *fp = fopen (name, "wb");
+  assert (fp != NULL);
+  assert (fwrite (data, sizeof (data), 1, fp) == 1);
+  fclose (fp);
+}
+
+int main (int argc, char **argv)
+{
+  uint32_t i;
+  Debug *debug;
+  char name[] = "/tmp/flexsoc-delta-XXXXXX";
+  
+  // Connect to target
+  Target *target = Target::Ptr (argv[1]);
+  assert (target != NULL);
+
+  // Validate CRC of CSR
+  assert (target->Validate () == 0);
+
+  // Set phy to SWD
+  target->SetPhy (PHY_SWD);
+
+  // Send reset + protocol switch
+  target->Reset (1);
+
+  // Enable AP access
+  assert (target->EnableAP (true) == 0);
+
+  // Enable bridge
+  target->BridgeAPSel (0);
+  target->BridgeEn (true);
+
+  // Create debug interface
+  debug = new Debug (target);
+  debug->SetScratch (0x20001800);
+
+  // Reset and halt target
+  assert (debug->Halt (true) == SUCCESS);
+
+  // Full load of random image
+  srand (time (NULL));
+  for (i = 0; i < sizeof (data) / sizeof (uint32_t); i++)
+    data[i] = rand ();
+  close (mkstemp (name));
+  write_image (name);
+  assert (debug->LoadBin (0x20000000, name) == SUCCESS);
+  assert (debug->VerifyImage (0x20000000, (uint8_t *)data, sizeof (data)) == SUCCESS);
+
+  // Change one word in two pages and delta load
+  data[10] ^= 0xFFFFFFFF;
+  data[700] ^= 0xFFFFFFFF;
+  write_image (name);
+  debug->SetDelta (true);
+  assert (debug->LoadBin (0x20000000, name) == SUCCESS);
+  assert (debug->VerifyImage (0x20000000, (uint8_t *)data, sizeof (data)) == SUCCESS);
+
+  // Only the two changed pages rewritten
+  assert (debug->DeltaPages () == 4);
+  assert (debug->DeltaWritten () == 2);
+
+  // Unchanged image writes nothing
+  assert (debug->LoadBin (0x20000000, name) == SUCCESS);
+  assert (debug->DeltaPages () == 4);
+  assert (debug->DeltaWritten () == 0);
+
+  // Clean up
+  unlink (name);
+  delete debug;
+  delete target;
+  
+  // Success
+  return 0;
+}
@@ -0,0 +1,116 @@
+/**
+ *  flexsoc-debug test
+ *
+ *  Program RAM backed flash model using flash algorithm framework
+ *
+ *  Tiny Labs Inc
+ *  2022
+ */
+
+#include <cassert>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "Target.h"
+#include "Debug.h"
+#include "Flash.h"
+#include "log.h"
+
+// Generated from target/armv7m_flash_ram.S
+#include "armv7m_flash_ram.h"
+
+// RAM layout
+#define ALGO_RAM     0x20000000
+#define ALGO_RAM_SZ  0x800
+#define SCRATCH      0x20000C00
+#define FLASH_BASE   0x20001000
+#define FLASH_SZ     0x1000
+
+static const flash_algo_t flash_ram = {
+  .blob = armv7m_flash_ram_bin,
+  .size = sizeof (armv7m_flash_ram_bin),
+  .init = 0x04,
+  .uninit = 0x08,
+  .erase_sector = 0x0C,
+  .program_page = 0x10,
+  .static_base = 0,
+  .flash_start = FLASH_BASE,
+  .flash_size = FLASH_SZ,
+  .page_size = 256,
+  .sector_size = 1024,
+  .erased = 0xFF,
+  .erase_ms = 0,
+  .program_ms = 0,
+};
+
+// Image buffer
+static uint32_t data[FLASH_SZ / 4];
+
+int main (int argc, char **argv)
+{
+  uint32_t i;
+  Debug *debug;
+  Flash *flash;
+  struct timespec start, end;
+  double secs;
+  
+  // Connect to target
+  Target *target = Target::Ptr (argv[1]);
+  assert (target != NULL);
+
+  // Validate CRC of CSR
+  assert (target->Validate () == 0);
+
+  // Set phy to SWD
+  target->SetPhy (PHY_SWD);
+
+  // Send reset + protocol switch
+  target->Reset (1);
+
+  // Enable AP access
+  assert (target->EnableAP (true) == 0);
+
+  // Enable bridge
+  target->BridgeAPSel (0);
+  target->BridgeEn (true);
+  target->BridgeMode (MODE_SEQUENTIAL);
+
+  // Create debug interface
+  debug = new Debug (target);
+  debug->SetScratch (SCRATCH);
+
+  // Reset and halt target
+  assert (debug->Halt (true) == SUCCESS);
+
+  // Load flash algorithm
+  flash = new Flash (target, debug);
+  assert (flash->Load (&flash_ram, ALGO_RAM, ALGO_RAM_SZ) == SUCCESS);
+
+  // Random image with partial last page
+  srand (time (NULL));
+  for (i = 0; i < sizeof (data) / sizeof (uint32_t); i++)
+    data[i] = rand ();
+
+  // Program and time
+  clock_gettime (CLOCK_MONOTONIC, &start);
+  assert (flash->Program (FLASH_BASE, (uint8_t *)data, sizeof (data) - 100) == SUCCESS);
+  clock_gettime (CLOCK_MONOTONIC, &end);
+  secs = (end.tv_sec - start.tv_sec) + ((end.tv_nsec - start.tv_nsec) / 1e9);
+  printf ("Programmed %lu bytes in %.3fs: %.2f KB/s\n",
+          sizeof (data) - 100, secs, ((sizeof (data) - 100) / 1024.0) / secs);
+  
+  // Verify image and erased tail
+  assert (debug->VerifyImage (FLASH_BASE, (uint8_t *)data, sizeof (data) - 100) == SUCCESS);
+  for (i = (sizeof (data) - 100) / 4; i < sizeof (data) / 4; i++)
+    data[i] = 0xFFFFFFFF;
+  assert (debug->VerifyImage (FLASH_BASE, (uint8_t *)data, sizeof (data)) == SUCCESS);
+
+  // Clean up
+  delete flash;
+  delete debug;
+  delete target;
+  
+  // Success
+  return 0;
+}
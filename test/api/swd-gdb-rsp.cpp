@@ -0,0 +1,201 @@
+/**
+ *  flexsoc-debug test
+ *
+ *  Scripted GDB remote protocol session against flexdbg --gdb. Checks
+ *  qSupported, g, m, X, bus faults on m/M answered with E01 and flash
+ *  programming through the .FLM algorithm.
+ *
+ *  Tiny Labs Inc
+ *  2022
+ */
+
+#include <cassert>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+// RAM layout - algorithm in scratch, flash model above
+#define GDB_PORT     3334
+#define SCRATCH      "0x20000000"
+#define RAM_ADDR     0x20000C00
+#define FLASH_BASE   0x20001000
+#define FLASH_SZ     0x1000
+
+// No slave decoded - AHB error response
+#define BAD_ADDR     0x60000000
+
+// Core registers in g reply
+#define GDB_REGS     17
+
+static int fd;
+static char pkt[8192];
+
+static void rsp_send (const char *data, int len)
+{
+  int i;
+  uint8_t sum = 0;
+  char buf[sizeof (pkt)];
+
+  for (i = 0; i < len; i++)
+    sum += (uint8_t)data[i];
+  buf[0] = '$';
+  memcpy (&buf[1], data, len);
+  sprintf (&buf[len + 1], "#%02x", sum);
+  assert (send (fd, buf, len + 4, 0) == len + 4);
+}
+
+// Read reply payload - acked if ack set
+static const char *rsp_recv (bool ack)
+{
+  char c;
+  int len = 0;
+
+  do
+    assert (recv (fd, &c, 1, 0) == 1);
+  while (c != '$');
+  while (1) {
+    assert (recv (fd, &c, 1, 0) == 1);
+    if (c == '#')
+      break;
+    assert (len < (int)sizeof (pkt) - 1);
+    pkt[len++] = c;
+  }
+  pkt[len] = '\0';
+  assert (recv (fd, &c, 1, 0) == 1);
+  assert (recv (fd, &c, 1, 0) == 1);
+  if (ack)
+    assert (send (fd, "+", 1, 0) == 1);
+  return pkt;
+}
+
+// Send packet, return reply - no ack mode after handshake
+static const char *rsp (const char *data, int len = -1)
+{
+  rsp_send (data, len < 0 ? strlen (data) : len);
+  return rsp_recv (false);
+}
+
+int main (int argc, char **argv)
+{
+  int i, len, status;
+  pid_t pid;
+  char c, cmd[1024];
+  char port[16];
+  uint8_t data[256];
+  struct sockaddr_in sa;
+  const char *r;
+
+  // Server owns the link to the target
+  snprintf (port, sizeof (port), "%d", GDB_PORT);
+  pid = fork ();
+  assert (pid >= 0);
+  if (pid == 0) {
+    execl (FLEXDBG, "flexdbg", "--gdb", port, "--scratch", SCRATCH,
+           "--flash", FLASH_FLM, argv[1], (char *)NULL);
+    _exit (127);
+  }
+
+  // Wait for listener
+  memset (&sa, 0, sizeof (sa));
+  sa.sin_family = AF_INET;
+  sa.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+  sa.sin_port = htons (GDB_PORT);
+  for (i = 0; i < 100; i++) {
+    fd = socket (AF_INET, SOCK_STREAM, 0);
+    assert (fd >= 0);
+    if (!connect (fd, (struct sockaddr *)&sa, sizeof (sa)))
+      break;
+    close (fd);
+    assert (waitpid (pid, &status, WNOHANG) == 0);
+    usleep (100000);
+  }
+  assert (i < 100);
+
+  // Handshake with acks then drop them
+  rsp_send ("qSupported:multiprocess+", 24);
+  assert (recv (fd, &c, 1, 0) == 1);
+  assert (c == '+');
+  r = rsp_recv (true);
+  printf ("qSupported: %s\n", r);
+  assert (strstr (r, "PacketSize="));
+  assert (strstr (r, "qXfer:memory-map:read+"));
+  rsp_send ("QStartNoAckMode", 15);
+  assert (recv (fd, &c, 1, 0) == 1);
+  assert (c == '+');
+  assert (!strcmp (rsp_recv (true), "OK"));
+
+  // Halted with full register file
+  assert (!strcmp (rsp ("?"), "S05"));
+  r = rsp ("g");
+  assert (strlen (r) == GDB_REGS * 8);
+
+  // X then m reads it back - avoid bytes needing escape
+  for (i = 0; i < (int)sizeof (data); i++) {
+    data[i] = (uint8_t)(rand () & 0x7F);
+    if ((data[i] == '#') || (data[i] == '$') || (data[i] == '}') || (data[i] == '*'))
+      data[i] = 0;
+  }
+  len = sprintf (cmd, "X%x,%x:", RAM_ADDR, (int)sizeof (data));
+  memcpy (&cmd[len], data, sizeof (data));
+  assert (!strcmp (rsp (cmd, len + sizeof (data)), "OK"));
+  sprintf (cmd, "m%x,%x", RAM_ADDR, (int)sizeof (data));
+  r = rsp (cmd);
+  assert (strlen (r) == sizeof (data) * 2);
+  for (i = 0; i < (int)sizeof (data); i++) {
+    unsigned b;
+    assert (sscanf (&r[i * 2], "%2x", &b) == 1);
+    assert (b == data[i]);
+  }
+
+  // Unaligned read crossing words
+  sprintf (cmd, "m%x,5", RAM_ADDR + 3);
+  assert (strlen (rsp (cmd)) == 10);
+
+  // Bus fault answers E01 - server keeps going
+  sprintf (cmd, "m%x,10", BAD_ADDR);
+  assert (!strcmp (rsp (cmd), "E01"));
+  sprintf (cmd, "M%x,5:0011223344", BAD_ADDR + 1);
+  assert (!strcmp (rsp (cmd), "E01"));
+  sprintf (cmd, "m%x,4", RAM_ADDR);
+  assert (strlen (rsp (cmd)) == 8);
+
+  // Flash through algorithm - partial page then a run after a gap
+  sprintf (cmd, "vFlashErase:%x,%x", FLASH_BASE + FLASH_SZ, FLASH_SZ);
+  assert (!strcmp (rsp (cmd), "E01"));
+  sprintf (cmd, "vFlashErase:%x,%x", FLASH_BASE, FLASH_SZ);
+  assert (!strcmp (rsp (cmd), "OK"));
+  len = sprintf (cmd, "vFlashWrite:%x:", FLASH_BASE + 0x100);
+  memcpy (&cmd[len], data, sizeof (data) - 16);
+  assert (!strcmp (rsp (cmd, len + sizeof (data) - 16), "OK"));
+  len = sprintf (cmd, "vFlashWrite:%x:", FLASH_BASE + 0x300);
+  memcpy (&cmd[len], data, 16);
+  assert (!strcmp (rsp (cmd, len + 16), "OK"));
+  assert (!strcmp (rsp ("vFlashDone"), "OK"));
+  sprintf (cmd, "m%x,%x", FLASH_BASE + 0x100, 0x210);
+  r = rsp (cmd);
+  for (i = 0; i < 0x210; i++) {
+    unsigned b;
+    assert (sscanf (&r[i * 2], "%2x", &b) == 1);
+    if (i < (int)sizeof (data) - 16)
+      assert (b == data[i]);
+    else if (i >= 0x200)
+      assert (b == data[i - 0x200]);
+    else
+      assert (b == 0xFF);
+  }
+
+  // Detach and stop server
+  assert (!strcmp (rsp ("D"), "OK"));
+  close (fd);
+  kill (pid, SIGKILL);
+  waitpid (pid, &status, 0);
+
+  // Success
+  return 0;
+}
@@ -0,0 +1,70 @@
+/**
+ *  flexsoc-debug test
+ *
+ *  Gateware DHCSR watch wakes host on halt
+ *
+ *  Tiny Labs Inc
+ *  2022
+ */
+
+#include <cassert>
+#include <stdio.h>
+#include "Target.h"
+#include "Debug.h"
+#include "log.h"
+
+#define STUB_ADDR  0x20000000
+
+// bkpt #0 ; nop ; bx lr ; b.n .
+static const uint16_t stub[] = {0xBE00, 0xBF00, 0x4770, 0xE7FE};
+
+int main (int argc, char **argv)
+{
+  Debug *debug;
+  uint32_t rv;
+  
+  // Connect to target
+  Target *target = Target::Ptr (argv[1]);
+  assert (target != NULL);
+
+  // Validate CRC of CSR
+  assert (target->Validate () == 0);
+
+  // Set phy to SWD
+  target->SetPhy (PHY_SWD);
+
+  // Send reset + protocol switch
+  target->Reset (1);
+
+  // Enable AP access
+  assert (target->EnableAP (true) == 0);
+
+  // Enable bridge
+  target->BridgeAPSel (0);
+  target->BridgeEn (true);
+
+  // Create debug interface
+  debug = new Debug (target);
+
+  // Reset and halt target
+  assert (debug->Halt (true) == SUCCESS);
+
+  // Load stub and enable watch
+  target->WriteH (STUB_ADDR, stub, 4);
+  assert (debug->WatchHalt (true) == SUCCESS);
+
+  // Return hits BKPT - notification wakes CallWait
+  assert (debug->Call (STUB_ADDR, 4, NULL, 0, 0, &rv, 100) == SUCCESS);
+
+  // Spin never halts
+  assert (debug->Call (STUB_ADDR, 6, NULL, 0, 0, &rv, 50) == -ERR_TIMEOUT);
+  assert (debug->Halt (false) == SUCCESS);
+  
+  // Clean up
+  assert (debug->WatchHalt (false) == SUCCESS);
+  delete debug;
+  delete target;
+  
+  // Success
+  return 0;
+}
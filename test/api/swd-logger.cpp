@@ -0,0 +1,88 @@
+/**
+ *  flexsoc-debug test
+ *
+ *  Coalesced variable logger
+ *
+ *  Tiny Labs Inc
+ *  2022
+ */
+
+#include <cassert>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Target.h"
+#include "Debug.h"
+#include "Logger.h"
+#include "log.h"
+
+#define VAR_ADDR  0x20000000
+
+int main (int argc, char **argv)
+{
+  int rows = 0;
+  FILE *fp;
+  Logger *logger;
+  char line[256];
+  char name[] = "/tmp/flexsoc-logger-XXXXXX";
+  uint32_t vars[2] = {0x12345678, 0xCAFEBABE};
+  
+  // Connect to target
+  Target *target = Target::Ptr (argv[1]);
+  assert (target != NULL);
+
+  // Validate CRC of CSR
+  assert (target->Validate () == 0);
+
+  // Set phy to SWD
+  target->SetPhy (PHY_SWD);
+
+  // Send reset + protocol switch
+  target->Reset (1);
+
+  // Enable AP access
+  assert (target->EnableAP (true) == 0);
+
+  // Enable bridge
+  target->BridgeAPSel (0);
+  target->BridgeEn (true);
+
+  // Known values in RAM
+  target->WriteW (VAR_ADDR, vars, 2);
+
+  // Word, two halves of same word and a byte at different rates
+  logger = new Logger (target);
+  assert (logger->Add ("word", VAR_ADDR, 4, 100) == SUCCESS);
+  assert (logger->Add ("lo", VAR_ADDR + 4, 2, 50) == SUCCESS);
+  assert (logger->Add ("hi", VAR_ADDR + 6, 2, 50) == SUCCESS);
+  assert (logger->Add ("byte", VAR_ADDR + 1, 1, 10) == SUCCESS);
+  assert (logger->Add ("bad", VAR_ADDR + 1, 4, 10) == -ERR_PARAMS);
+
+  // Log to CSV
+  close (mkstemp (name));
+  assert (logger->Open (name, LOGGER_CSV) == SUCCESS);
+  assert (logger->Run (0.5) == SUCCESS);
+  logger->Close ();
+  assert (logger->Samples () > 0);
+
+  // Check header and first row has every variable
+  fp = fopen (name, "r");
+  assert (fp != NULL);
+  assert (fgets (line, sizeof (line), fp));
+  assert (!strcmp (line, "usec,word,lo,hi,byte\n"));
+  assert (fgets (line, sizeof (line), fp));
+  assert (strstr (line, ",305419896,47806,51966,86\n"));
+  while (fgets (line, sizeof (line), fp))
+    rows++;
+  fclose (fp);
+  assert (rows > 0);
+
+  // Clean up
+  unlink (name);
+  delete logger;
+  delete target;
+  
+  // Success
+  return 0;
+}
@@ -0,0 +1,117 @@
+/**
+ *  flexsoc-debug test
+ *
+ *  Tiny Labs Inc
+ *  2022
+ */
+
+#include <cassert>
+#include <unistd.h>
+#include <string.h>
+#include "Target.h"
+#include "log.h"
+
+// Global buffers
+static uint32_t verify[64];
+
+void test_fill (Target *target, uint32_t value, uint8_t width, uint32_t cnt)
+{
+  uint32_t i;
+  
+  // Clear target memory
+  memset (verify, 0x5A, sizeof (verify));
+  target->WriteW (0x20000000, verify, sizeof (verify) / 4);
+
+  // Fill region
+  target->Fill (0x20000000, value, width, cnt);
+
+  // Read back
+  target->ReadW (0x20000000, verify, sizeof (verify) / 4);
+
+  // Verify filled region
+  for (i = 0; i < cnt; i++) {
+    switch (width) {
+      case 1: assert (((uint8_t *)verify)[i] == (uint8_t)value); break;
+      case 2: assert (((uint16_t *)verify)[i] == (uint16_t)value); break;
+      case 4: assert (verify[i] == value); break;
+    }
+  }
+
+  // Verify we didn't overrun
+  assert (((uint8_t *)verify)[cnt * width] == 0x5A);
+}
+
+int main (int argc, char **argv)
+{
+  uint32_t i, val = 0;
+  
+  // Connect to target
+  Target *target = Target::Ptr (argv[1]);
+  assert (target != NULL);
+
+  // Validate CRC of CSR
+  assert (target->Validate () == 0);
+
+  // Set phy to SWD
+  target->SetPhy (PHY_SWD);
+
+  // Send reset + protocol switch
+  target->Reset (1);
+
+  // Enable debug for AP access
+  assert (target->WriteDP (4, 0x50000000) == ADIv5_OK);
+
+  // Poll for ACK
+  for (i = 0; i < 10; i++) {
+    assert (target->ReadDP (4, &val) == ADIv5_OK);
+    if ((val & 0xF0000000) == 0xF0000000)
+      break;
+  }
+
+  // Check for ACK
+  assert ((val & 0xF0000000) == 0xF0000000);
+
+  // Write CSW for word access
+  assert (target->WriteAP (0, 0xA2000002) == ADIv5_OK);
+
+  // Set TAR to access DHCSR
+  assert (target->WriteAP (4, 0xE000EDF0) == ADIv5_OK);
+
+  // Try to halt processor
+  for (i = 0; i < 10; i++) {
+
+    // Write key + C_HALT to DHCSR
+    assert (target->WriteAP (0xC, 0xA05F0003) == ADIv5_OK);
+
+    // Check S_HALT to see if we halted
+    assert (target->ReadAP (0xC, &val) == ADIv5_OK);
+    if (val & (1 << 17))
+      break;
+  }
+
+  // Check if halt failed
+  assert (i != 10);
+
+  // Always use AP0 = MEM-AP
+  target->BridgeAPSel (0);
+
+  // Enable bridge
+  target->BridgeEn (true);
+  target->BridgeMode (MODE_SEQUENTIAL);
+
+  // Test each width
+  test_fill (target, 0xDEADBEEF, 4, 1);
+  test_fill (target, 0x00000000, 4, 63);
+  test_fill (target, 0xFFFFFFFF, 4, 17);
+  test_fill (target, 0x1234, 2, 33);
+  test_fill (target, 0xA5, 1, 101);
+
+  // Disable bridge
+  target->BridgeEn (false);
+  
+  // Close device
+  delete target;
+  
+  // Success
+  return 0;
+}
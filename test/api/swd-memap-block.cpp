@@ -0,0 +1,84 @@
+/**
+ *  flexsoc-debug test
+ *
+ *  Block transfers through MEM-AP with bridge disabled
+ *
+ *  Tiny Labs Inc
+ *  2022
+ */
+
+#include <cassert>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "Target.h"
+#include "log.h"
+
+// Unaligned to 1KB so auto-increment wraps are crossed
+#define BLOCK_ADDR  0x20000100
+#define BLOCK_WORDS 1024
+
+static double now (void)
+{
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + (ts.tv_nsec / 1e9);
+}
+
+// Write then read back block - returns KB/s for round trip
+static double xfer (Target *target, uint32_t *src, uint32_t *dst)
+{
+  double start = now ();
+
+  memset (dst, 0, BLOCK_WORDS * 4);
+  target->WriteW (BLOCK_ADDR, src, BLOCK_WORDS);
+  target->ReadW (BLOCK_ADDR, dst, BLOCK_WORDS);
+  assert (!memcmp (src, dst, BLOCK_WORDS * 4));
+  return (2 * BLOCK_WORDS * 4) / ((now () - start) * 1024);
+}
+
+int main (int argc, char **argv)
+{
+  int i;
+  double memap, brg;
+  uint32_t src[BLOCK_WORDS], dst[BLOCK_WORDS];
+  
+  // Connect to target
+  Target *target = Target::Ptr (argv[1]);
+  assert (target != NULL);
+
+  // Validate CRC of CSR
+  assert (target->Validate () == 0);
+
+  // Set phy to SWD
+  target->SetPhy (PHY_SWD);
+
+  // Send reset + protocol switch
+  target->Reset (1);
+
+  // Enable AP access
+  assert (target->EnableAP (true) == 0);
+
+  for (i = 0; i < BLOCK_WORDS; i++)
+    src[i] = (0x01010101 * i) ^ 0xA5A5A5A5;
+
+  // Bridge off - driven through MEM-AP DRW
+  target->BridgeEn (false);
+  memap = xfer (target, src, dst);
+
+  // Single words either side of wrap
+  target->ReadW (BLOCK_ADDR + 0x2FC, dst, 2);
+  assert ((dst[0] == src[0xBF]) && (dst[1] == src[0xC0]));
+
+  // Same transfer over bridge
+  target->BridgeAPSel (0);
+  target->BridgeEn (true);
+  brg = xfer (target, src, dst);
+  printf ("MEM-AP: %.1f KB/s bridge: %.1f KB/s\n", memap, brg);
+
+  // Close device
+  delete target;
+  
+  // Success
+  return 0;
+}
@@ -0,0 +1,85 @@
+/**
+ *  flexsoc-debug test
+ *
+ *  PC sampling profiler driven through flexdbg --profile. Runs a
+ *  workload with one hot and one cold function and checks the samples
+ *  land in the right symbols.
+ *
+ *  Tiny Labs Inc
+ *  2022
+ */
+
+#include <cassert>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Target.h"
+#include "Debug.h"
+#include "log.h"
+
+// Profile window in seconds
+#define PROFILE_SECS  "1"
+
+static Target *connect (char *id)
+{
+  Target *target = Target::Ptr (id);
+  assert (target != NULL);
+  assert (target->Validate () == 0);
+  target->SetPhy (PHY_SWD);
+  target->Reset (1);
+  assert (target->EnableAP (true) == 0);
+  target->BridgeAPSel (0);
+  target->BridgeEn (true);
+  return target;
+}
+
+int main (int argc, char **argv)
+{
+  FILE *fp;
+  Debug *debug;
+  Target *target;
+  uint32_t entry, hot = 0, cold = 0, cnt;
+  char cmd[512], name[64], folded[] = "/tmp/flexsoc-folded-XXXXXX";
+
+  // Load workload and leave it running
+  target = connect (argv[1]);
+  debug = new Debug (target);
+  assert (debug->Halt (true) == SUCCESS);
+  assert (debug->LoadImage (PROFILE_ELF, 0, &entry) == SUCCESS);
+  assert (debug->RegWrite (REG_PC, entry | 1) == SUCCESS);
+  assert (debug->RegWrite (REG_xPSR, 1 << 24) == SUCCESS);
+  assert (debug->Resume () == SUCCESS);
+  delete debug;
+  delete target;
+
+  // Profiler owns the link while sampling
+  close (mkstemp (folded));
+  snprintf (cmd, sizeof (cmd), "%s --profile %s --duration %s --folded %s %s",
+            FLEXDBG, PROFILE_ELF, PROFILE_SECS, folded, argv[1]);
+  assert (system (cmd) == 0);
+
+  // Sorted by count - hot first, cold sampled far less
+  fp = fopen (folded, "r");
+  assert (fp != NULL);
+  assert (fscanf (fp, "%63s %u", name, &hot) == 2);
+  printf ("Hottest: %s %u\n", name, hot);
+  assert (!strcmp (name, "hot"));
+  while (fscanf (fp, "%63s %u", name, &cnt) == 2)
+    if (!strcmp (name, "cold"))
+      cold = cnt;
+  printf ("cold: %u\n", cold);
+  assert (cold * 10 < hot);
+  fclose (fp);
+  unlink (folded);
+
+  // Stop workload
+  target = connect (argv[1]);
+  debug = new Debug (target);
+  assert (debug->Halt (false) == SUCCESS);
+  delete debug;
+  delete target;
+
+  // Success
+  return 0;
+}
@@ -0,0 +1,78 @@
+/**
+ *  flexsoc-debug test
+ *
+ *  Batched core register access
+ *
+ *  Tiny Labs Inc
+ *  2022
+ */
+
+#include <cassert>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "Target.h"
+#include "Debug.h"
+#include "log.h"
+
+int main (int argc, char **argv)
+{
+  int i;
+  Debug *debug;
+  uint32_t val, wr[13], rd[DEBUG_ALL_REGS];
+  reg_t reg[13];
+  
+  // Connect to target
+  Target *target = Target::Ptr (argv[1]);
+  assert (target != NULL);
+
+  // Validate CRC of CSR
+  assert (target->Validate () == 0);
+
+  // Set phy to SWD
+  target->SetPhy (PHY_SWD);
+
+  // Send reset + protocol switch
+  target->Reset (1);
+
+  // Enable AP access
+  assert (target->EnableAP (true) == 0);
+
+  // Enable bridge
+  target->BridgeAPSel (0);
+  target->BridgeEn (true);
+
+  // Create debug interface
+  debug = new Debug (target);
+
+  // Reset and halt target
+  assert (debug->Halt (true) == SUCCESS);
+
+  // Batch write R0-R12
+  srand (time (NULL));
+  for (i = 0; i < 13; i++) {
+    reg[i] = (reg_t)(REG_R0 + i);
+    wr[i] = rand ();
+  }
+  assert (debug->RegWriteMulti (reg, wr, 13) == SUCCESS);
+
+  // Batch read full core context
+  assert (debug->ReadAllRegs (rd, false) == SUCCESS);
+  for (i = 0; i < 13; i++)
+    assert (rd[i] == wr[i]);
+
+  // Compare against single register reads
+  for (i = 0; i < 13; i++) {
+    assert (debug->RegRead (reg[i], &val) == SUCCESS);
+    assert (val == rd[i]);
+  }
+  assert (debug->RegRead (REG_PC, &val) == SUCCESS);
+  assert (val == rd[15]);
+  
+  // Clean up
+  delete debug;
+  delete target;
+  
+  // Success
+  return 0;
+}
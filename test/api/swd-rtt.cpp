@@ -0,0 +1,105 @@
+/**
+ *  flexsoc-debug test
+ *
+ *  RTT up-channel reader
+ *
+ *  Tiny Labs Inc
+ *  2022
+ */
+
+#include <cassert>
+#include <stdio.h>
+#include <string.h>
+#include "Target.h"
+#include "Debug.h"
+#include "Rtt.h"
+#include "log.h"
+
+#define RAM_ADDR  0x20000000
+#define CB_ADDR   0x20000040
+#define BUF_ADDR  0x20000100
+#define BUF_SZ    64
+
+// Byte offsets of up[0] offsets in control block
+#define WR_OFF    (CB_ADDR + 24 + 12)
+#define RD_OFF    (CB_ADDR + 24 + 16)
+
+int main (int argc, char **argv)
+{
+  int i;
+  Rtt *rtt;
+  uint32_t off;
+  uint8_t src[BUF_SZ], dst[BUF_SZ];
+  uint32_t cblk[12] = {
+    0, 0, 0, 0,                  // ID
+    1, 0,                        // MaxNumUpBuffers, MaxNumDownBuffers
+    0, BUF_ADDR, BUF_SZ, 0, 0, 0 // up[0]
+  };
+
+  // Connect to target
+  Target *target = Target::Ptr (argv[1]);
+  assert (target != NULL);
+
+  // Validate CRC of CSR
+  assert (target->Validate () == 0);
+
+  // Set phy to SWD
+  target->SetPhy (PHY_SWD);
+
+  // Send reset + protocol switch
+  target->Reset (1);
+
+  // Enable AP access
+  assert (target->EnableAP (true) == 0);
+
+  // Enable bridge
+  target->BridgeAPSel (0);
+  target->BridgeEn (true);
+
+  // Place control block as firmware would
+  memcpy (cblk, "SEGGER RTT", 11);
+  target->WriteW (CB_ADDR, cblk, 12);
+  for (i = 0; i < BUF_SZ; i++)
+    src[i] = i * 3;
+
+  // Locate and cache geometry
+  rtt = new Rtt (target);
+  assert (rtt->Find (RAM_ADDR, 0x1000) == SUCCESS);
+  assert (rtt->Address () == CB_ADDR);
+  assert (rtt->Channels () == 1);
+  assert (rtt->Size (0) == BUF_SZ);
+
+  // Idle poll
+  assert (rtt->Poll (0, dst, BUF_SZ) == 0);
+
+  // Unaligned run without wrap
+  target->WriteB (BUF_ADDR, src, 41);
+  off = 41;
+  target->WriteW (WR_OFF, &off, 1);
+  assert (rtt->Poll (0, dst, BUF_SZ) == 41);
+  assert (!memcmp (dst, src, 41));
+  target->ReadW (RD_OFF, &off, 1);
+  assert (off == 41);
+
+  // Wrapped run
+  target->WriteB (BUF_ADDR + 41, src + 41, BUF_SZ - 41);
+  target->WriteB (BUF_ADDR, src, 17);
+  off = 17;
+  target->WriteW (WR_OFF, &off, 1);
+  assert (rtt->Poll (0, dst, BUF_SZ) == BUF_SZ - 41 + 17);
+  assert (!memcmp (dst, src + 41, BUF_SZ - 41));
+  assert (!memcmp (dst + BUF_SZ - 41, src, 17));
+  target->ReadW (RD_OFF, &off, 1);
+  assert (off == 17);
+
+  // Stream idle channel
+  assert (rtt->Run (0, NULL, 0.1) == SUCCESS);
+  assert (rtt->Bytes () == 0);
+
+  // Clean up
+  delete rtt;
+  delete target;
+  
+  // Success
+  return 0;
+}
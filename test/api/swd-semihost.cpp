@@ -0,0 +1,92 @@
+/**
+ *  flexsoc-debug test
+ *
+ *  Semihosting console served on gateware halt notification
+ *
+ *  Tiny Labs Inc
+ *  2022
+ */
+
+#include <cassert>
+#include <stdio.h>
+#include <string.h>
+#include "Target.h"
+#include "Debug.h"
+#include "Semihost.h"
+#include "log.h"
+#include "armv7m_semihost.h"
+
+#define STUB_ADDR   0x20000000
+#define STUB_SP     0x20001000
+#define BENCH_ENTRY 4
+
+// Messages printed by benchmark
+#define BENCH_CNT   1000
+#define BENCH_MSG   "flexsoc semihosting console benchmark 0123456789abcdef\n"
+
+int main (int argc, char **argv)
+{
+  Debug *debug;
+  Semihost *semi;
+  FILE *fp;
+  uint32_t status = 0xFFFFFFFF;
+  uint32_t cnt = BENCH_CNT;
+  uint32_t stub[(sizeof (armv7m_semihost_bin) + 3) / 4];
+
+  // Connect to target
+  Target *target = Target::Ptr (argv[1]);
+  assert (target != NULL);
+
+  // Validate CRC of CSR
+  assert (target->Validate () == 0);
+
+  // Set phy to SWD
+  target->SetPhy (PHY_SWD);
+
+  // Send reset + protocol switch
+  target->Reset (1);
+
+  // Enable AP access
+  assert (target->EnableAP (true) == 0);
+
+  // Enable bridge
+  target->BridgeAPSel (0);
+  target->BridgeEn (true);
+
+  // Create debug interface
+  debug = new Debug (target);
+
+  // Reset and halt target
+  assert (debug->Halt (true) == SUCCESS);
+
+  // Load benchmark
+  memset (stub, 0, sizeof (stub));
+  memcpy (stub, armv7m_semihost_bin, sizeof (armv7m_semihost_bin));
+  target->WriteW (STUB_ADDR, stub, sizeof (stub) / 4);
+
+  // Discard console output
+  fp = fopen ("/dev/null", "w");
+  assert (fp != NULL);
+  semi = new Semihost (target, debug);
+  semi->SetConsole (fp);
+
+  // Serve until SYS_EXIT
+  assert (debug->CallStart (STUB_ADDR, BENCH_ENTRY, &cnt, 1, STUB_SP) == SUCCESS);
+  assert (semi->Run (10000, &status) == SEMI_EXIT);
+  assert (status == 0);
+  assert (semi->ConsoleBytes () == BENCH_CNT * strlen (BENCH_MSG));
+  printf ("Semihost console: %.1f KB/s\n", semi->ConsoleRate () / 1024);
+
+  // Core left halted on exit call
+  assert (debug->WaitHalt (0) == SUCCESS);
+
+  // Clean up
+  assert (debug->WatchHalt (false) == SUCCESS);
+  delete semi;
+  fclose (fp);
+  delete debug;
+  delete target;
+
+  // Success
+  return 0;
+}
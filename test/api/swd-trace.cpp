@@ -0,0 +1,86 @@
+/**
+ *  flexsoc-debug test
+ *
+ *  Batched instruction step tracing
+ *
+ *  Tiny Labs Inc
+ *  2022
+ */
+
+#include <cassert>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "Target.h"
+#include "Debug.h"
+#include "log.h"
+
+#define LOOP_ADDR  0x20000000
+#define STEPS      1000
+
+// adds r0, #1 ; b.n .-2
+static const uint16_t loop[] = {0x3001, 0xE7FD};
+
+int main (int argc, char **argv)
+{
+  int i;
+  FILE *fp;
+  Debug *debug;
+  uint32_t rec[2];
+  char name[] = "/tmp/flexsoc-trace-XXXXXX";
+  reg_t reg = REG_R0;
+  
+  // Connect to target
+  Target *target = Target::Ptr (argv[1]);
+  assert (target != NULL);
+
+  // Validate CRC of CSR
+  assert (target->Validate () == 0);
+
+  // Set phy to SWD
+  target->SetPhy (PHY_SWD);
+
+  // Send reset + protocol switch
+  target->Reset (1);
+
+  // Enable AP access
+  assert (target->EnableAP (true) == 0);
+
+  // Enable bridge
+  target->BridgeAPSel (0);
+  target->BridgeEn (true);
+
+  // Create debug interface
+  debug = new Debug (target);
+
+  // Reset and halt target
+  assert (debug->Halt (true) == SUCCESS);
+
+  // Load loop and point core at it
+  target->WriteH (LOOP_ADDR, loop, 2);
+  assert (debug->RegWrite (REG_R0, 0) == SUCCESS);
+  assert (debug->RegWrite (REG_PC, LOOP_ADDR | 1) == SUCCESS);
+  assert (debug->RegWrite (REG_xPSR, 1 << 24) == SUCCESS);
+
+  // Trace PC and R0
+  close (mkstemp (name));
+  assert (debug->Trace (name, STEPS, &reg, 1) == SUCCESS);
+
+  // PC alternates between instructions, R0 bumps every other step
+  fp = fopen (name, "rb");
+  assert (fp != NULL);
+  for (i = 0; i < STEPS; i++) {
+    assert (fread (rec, sizeof (rec), 1, fp) == 1);
+    assert (rec[0] == LOOP_ADDR + ((i & 1) ? 0 : 2));
+    assert (rec[1] == (uint32_t)((i / 2) + 1));
+  }
+  fclose (fp);
+
+  // Clean up
+  unlink (name);
+  delete debug;
+  delete target;
+  
+  // Success
+  return 0;
+}
@@ -0,0 +1,210 @@
+/*
+ * Benchmark remote IRQ forwarding latency and loss-free rate
+ *
+ * Numbers are reported only - wall-clock timing depends on the host and
+ * simulator. Set IRQ_BENCH_MIN_HZ to fail below a loss-free rate.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <pthread.h>
+#include <cassert>
+
+#include "Target.h"
+#include "Debug.h"
+#include "irq.h"
+
+// IRQs wired to GPIO - exception number is IRQ + 16
+#define IRQ_LINES     4
+
+// Latency samples - one IRQ in flight at a time
+#define LAT_SAMPLES   100
+#define LAT_TIMEOUT   1000   // ms - slower counts as missed
+
+// Rate sweep - IRQS_PER_RATE pulses at each rate doubling from RATE_MIN
+#define RATE_MIN      20
+#define RATE_MAX      20480
+#define IRQS_PER_RATE 64
+#define DRAIN_MS      1000   // Quiet time before counting
+
+static Target *targ;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t cond = PTHREAD_COND_INITIALIZER;
+static uint32_t recvd;
+static uint64_t recvd_us;
+
+static uint64_t now_us (void)
+{
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ((uint64_t)ts.tv_sec * 1000000ULL) + (ts.tv_nsec / 1000);
+}
+
+void irq_handler (uint8_t ctl, uint8_t irq)
+{
+  // Timestamp before ack
+  pthread_mutex_lock (&lock);
+  recvd_us = now_us ();
+  recvd++;
+  pthread_cond_broadcast (&cond);
+  pthread_mutex_unlock (&lock);
+
+  // Acknowledge IRQ
+  targ->IRQAck (ctl);
+}
+
+// Wait until count reached or ms without a new IRQ
+static uint32_t wait_irq (uint32_t cnt, int ms)
+{
+  struct timespec ts;
+  uint32_t rv;
+  int rc = 0;
+
+  pthread_mutex_lock (&lock);
+  while ((recvd < cnt) && (rc != ETIMEDOUT)) {
+    clock_gettime (CLOCK_REALTIME, &ts);
+    ts.tv_nsec += (ms % 1000) * 1000000L;
+    ts.tv_sec += (ms / 1000) + (ts.tv_nsec / 1000000000L);
+    ts.tv_nsec %= 1000000000L;
+    rc = pthread_cond_timedwait (&cond, &lock, &ts);
+  }
+  rv = recvd;
+  pthread_mutex_unlock (&lock);
+  return rv;
+}
+
+static int cmp_u64 (const void *a, const void *b)
+{
+  uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+  return (x > y) - (x < y);
+}
+
+int main (int argc, char **argv)
+{
+  uint32_t irq_buf, i, n = 0, base, rate, sent, got, fwd, best = 0;
+  uint64_t lat[LAT_SAMPLES], start, next;
+  const char *min_hz;
+  Debug *debug;
+
+  // Connect to target
+  Target *target = Target::Ptr (argv[1]);
+  assert (target != NULL);
+
+  // Save global pointer
+  targ = target;
+
+  // Set mode to SWD
+  target->SetPhy (PHY_SWD);
+
+  // Send reset
+  target->Reset (1);
+
+  // Enable AP access
+  target->EnableAP (true);
+
+  // Enable bridge
+  target->BridgeEn (true);
+
+  // Create debug interface
+  debug = new Debug (target);
+
+  // Reset and halt target
+  assert (debug->Halt (true) == SUCCESS);
+
+  // Load exe to RAM
+  assert (debug->LoadBin (0x20000000, argv[2]) == SUCCESS);
+
+  // Set PC to exe
+  assert (debug->RegWrite (REG_PC, 0x20000001) == SUCCESS);
+
+  // Register IRQ handler
+  target->RegisterIRQHandler (&irq_handler);
+
+  // Get IRQ base from image offset +4
+  irq_buf = target->ReadReg (0x20000004);
+
+  // Set IRQ buf for hardware
+  target->BridgeIRQBuf (irq_buf);
+
+  // Run target
+  assert (debug->Run () == SUCCESS);
+
+  // Enable IRQ scanning
+  target->BridgeIRQScanEn (true);
+
+  // Enable IRQs under test
+  target->WriteReg (0xE000E100, (1 << IRQ_LINES) - 1);
+
+  // Init IRQs
+  irq_init (8888);
+
+  // Delay to allow simulated hardware to catch up
+  sleep (5);
+
+  // Latency - injection to host callback
+  for (i = 0; i < LAT_SAMPLES; i++) {
+    base = recvd;
+    start = now_us ();
+    pulse_irq (i % IRQ_LINES);
+    if (wait_irq (base + 1, LAT_TIMEOUT) == base + 1)
+      lat[n++] = recvd_us - start;
+    else
+      wait_irq (base + 1, DRAIN_MS); // Don't let a late one skew the next
+  }
+  printf ("IRQ latency: %u/%u within %u ms\n", n, LAT_SAMPLES, LAT_TIMEOUT);
+  if (n) {
+    qsort (lat, n, sizeof (lat[0]), cmp_u64);
+    printf ("IRQ latency (us): min=%llu p50=%llu p90=%llu p99=%llu max=%llu\n",
+            (unsigned long long)lat[0],
+            (unsigned long long)lat[n / 2],
+            (unsigned long long)lat[(n * 90) / 100],
+            (unsigned long long)lat[(n * 99) / 100],
+            (unsigned long long)lat[n - 1]);
+  }
+
+  // Sweep injection rate until an IRQ is lost. Gateware forward count
+  // tells whether it was dropped before or after the bridge.
+  for (rate = RATE_MIN; rate <= RATE_MAX; rate *= 2) {
+    sent = recvd;
+    fwd = target->BridgeIRQCount ();
+    next = now_us ();
+    for (i = 0; i < IRQS_PER_RATE; i++) {
+      pulse_irq (i % IRQ_LINES);
+      next += 1000000 / rate;
+      while (now_us () < next)
+        ;
+    }
+    got = wait_irq (sent + IRQS_PER_RATE, DRAIN_MS) - sent;
+    fwd = target->BridgeIRQCount () - fwd;
+    printf ("%6u Hz: sent=%u forwarded=%u received=%u\n",
+            rate, IRQS_PER_RATE, fwd, got);
+    if (fwd < IRQS_PER_RATE) {
+      printf ("%6u Hz: %u lost in gateware\n", rate, IRQS_PER_RATE - fwd);
+      break;
+    }
+    if (got < fwd) {
+      printf ("%6u Hz: %u lost on host\n", rate, fwd - got);
+      break;
+    }
+    best = rate;
+  }
+  printf ("Max loss-free IRQ rate: %u Hz\n", best);
+
+  // Optional floor for runs on known hardware
+  min_hz = getenv ("IRQ_BENCH_MIN_HZ");
+  if (min_hz)
+    assert (best >= strtoul (min_hz, NULL, 0));
+
+  // Clean up IRQ
+  target->UnregisterIRQHandler ();
+  irq_exit ();
+
+  // Clean up target
+  delete debug;
+  delete target;
+  return 0;
+}
@@ -43,6 +43,9 @@ elif [ $# -eq 5 ]; then
     HOST_PORT=($(echo $4 | tr ':' ' '))
     HOST=${HOST_PORT[0]}
     PORT=${HOST_PORT[1]}
+
+    # Transport port option (-u UART, -f FT245)
+    SIM_PORT_OPT=${SIM_PORT_OPT:--u}
 else
     echo "Incorrect args!"
     exit -1
@@ -64,9 +67,9 @@ if [ -n "$SIM" ]; then
     # Trace if necessary
     if [ "$TRACE" = true ]; then
         rm ${EXE}.fst
-        $SIM -u$PORT -r --fst=${EXE}.fst &
+        $SIM $SIM_PORT_OPT$PORT -r --fst=${EXE}.fst &
     else
-        $SIM -u$PORT -r &
+        $SIM $SIM_PORT_OPT$PORT -r &
     fi
     SIM_PID=$!
     sleep 1